@@ -0,0 +1,236 @@
+#include "parser/parser.hh"
+#include "parser/fold.hh"
+#include "parser/printer.hh"
+#include "parser/sema.hh"
+#include "codegen/codegen.hh"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+using namespace Frontend;
+
+// Generated programs, n is the number of terms or the nesting depth
+//   chain  - one expression of n terms, left-deep like any long sum
+//   parens - x + (x + (x + ...)), n deep on the right
+//   blocks - if/while/for nested n deep, a declaration in each
+static std::string chainSource(size_t n)
+{
+    static const char* terms[] = {"x", "y * 3", "(x - y)", "-y", "x / 2"};
+    static const char* oprs[] = {" + ", " - ", " * "};
+
+    std::string src = "int main()\n{\n    int x = 1;\n    int y = 2;\n"
+                      "    int z = x";
+    for (size_t i = 1; i < n; i++)
+    {
+        src += oprs[i % 3];
+        src += terms[i % 5];
+    }
+    src += ";\n    printVarInt(z);\n    return 0;\n}\n";
+    return src;
+}
+
+static std::string parensSource(size_t n)
+{
+    std::string src = "int main()\n{\n    int x = 1;\n    int z = ";
+    for (size_t i = 1; i < n; i++) src += "x + (";
+    src += "x";
+    src += std::string(n - 1, ')');
+    src += ";\n    printVarInt(z);\n    return 0;\n}\n";
+    return src;
+}
+
+static std::string blocksSource(size_t n)
+{
+    std::string src = "int main()\n{\n    int x = 0;\n";
+    for (size_t i = 0; i < n; i++)
+    {
+        auto var = "v" + std::to_string(i);
+        switch (i % 3)
+        {
+            case 0:
+                src += "    if (x < " + std::to_string(i + 1) + ")\n    {\n";
+                break;
+            case 1:
+                src += "    while (x < " + std::to_string(i + 1) + ")\n    {\n";
+                src += "    x = x + 1;\n";
+                break;
+            case 2:
+                src += "    for (int " + var + "i = 0; " + var + "i < 1; " +
+                       var + "i = " + var + "i + 1)\n    {\n";
+                break;
+        }
+        src += "    int " + var + " = x + " + std::to_string(i) + ";\n";
+    }
+    src += "    printVarInt(x);\n";
+    src += std::string(n, '}');
+    src += "\n    printVarInt(x);\n    return 0;\n}\n";
+    return src;
+}
+
+// Counts what is written and throws it away
+class NullBuf : public std::streambuf
+{
+  public:
+    size_t bytes = 0;
+
+  protected:
+    std::streamsize xsputn(const char*, std::streamsize n) override
+    {
+        bytes += n;
+        return n;
+    }
+    int overflow(int ch) override
+    {
+        bytes++;
+        return ch;
+    }
+};
+
+struct Result
+{
+    double parse = 0, fold = 0, sema = 0, gen = 0, print = 0;
+    size_t print_bytes = 0;
+};
+
+struct Job
+{
+    const char* fn;
+    bool print;
+    Result result;
+};
+
+static double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count();
+}
+
+// Every stage of the compiler over one file
+static void* compile(void *arg)
+{
+    auto &job = *static_cast<Job*>(arg);
+    auto &result = job.result;
+
+    auto start = std::chrono::steady_clock::now();
+    Parser parser(job.fn);
+    result.parse = since(start);
+
+    start = std::chrono::steady_clock::now();
+    ASTFolder(parser.getProgram()).foldProgram();
+    result.fold = since(start);
+
+    start = std::chrono::steady_clock::now();
+    Sema(parser).run();
+    result.sema = since(start);
+
+    if (job.print)
+    {
+        NullBuf buf;
+        std::ostream out(&buf);
+
+        start = std::chrono::steady_clock::now();
+        parser.printStatements(out);
+        result.print = since(start);
+        result.print_bytes = buf.bytes;
+    }
+
+    start = std::chrono::steady_clock::now();
+    Codegen codegen(job.fn, "/dev/null");
+    codegen.setParser(&parser);
+    codegen.gen();
+    result.gen = since(start);
+
+    return nullptr;
+}
+
+// On a thread with a native stack of stack_size bytes, which any
+// recursion as deep as the input would overflow
+static Result run(const std::string &src, bool print, size_t stack_size)
+{
+    char fn[] = "/tmp/bench_XXXXXX";
+    int fd = mkstemp(fn);
+    if (fd < 0 || write(fd, src.data(), src.size()) != (ssize_t)src.size())
+    {
+        std::cerr << "[Error] bench: cannot write " << fn << "\n";
+        exit(0);
+    }
+    close(fd);
+
+    Job job{fn, print};
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_size);
+
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, compile, &job) != 0)
+    {
+        std::cerr << "[Error] bench: cannot start a thread\n";
+        exit(0);
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+
+    unlink(fn);
+    return job.result;
+}
+
+int main(int argc, char* argv[])
+{
+    // bench [stack KB]
+    size_t stack_kb = (argc > 1) ? atoi(argv[1]) : 256;
+
+    struct Shape
+    {
+        const char* name;
+        std::string (*source)(size_t);
+        size_t sizes[3];
+        // the dump indents by expression depth, its size is quadratic
+        // in these, so it is only written for the smallest
+        bool print_all;
+    };
+    const Shape shapes[] =
+    {
+        {"chain", chainSource, {25000, 50000, 100000}, false},
+        {"parens", parensSource, {2500, 5000, 10000}, false},
+        {"blocks", blocksSource, {2500, 5000, 10000}, true}
+    };
+
+    std::cout << "native stack " << stack_kb << " KB\n"
+              << std::setw(7) << "shape" << std::setw(8) << "n"
+              << std::setw(10) << "parse" << std::setw(10) << "fold"
+              << std::setw(10) << "sema" << std::setw(10) << "codegen"
+              << std::setw(12) << "ns/n" << std::setw(10) << "print"
+              << std::setw(10) << "dump MB" << "\n";
+
+    for (auto &shape : shapes)
+    {
+        for (auto n : shape.sizes)
+        {
+            bool print = shape.print_all || n == shape.sizes[0];
+            auto result = run(shape.source(n), print, stack_kb * 1024);
+
+            auto total = result.parse + result.fold + result.sema + result.gen;
+            std::cout << std::setw(7) << shape.name << std::setw(8) << n
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(10) << result.parse * 1e3
+                      << std::setw(10) << result.fold * 1e3
+                      << std::setw(10) << result.sema * 1e3
+                      << std::setw(10) << result.gen * 1e3
+                      << std::setw(12) << total * 1e9 / n;
+            if (print)
+            {
+                std::cout << std::setw(10) << result.print * 1e3
+                          << std::setw(10) << result.print_bytes / 1e6;
+            }
+            std::cout << "\n";
+        }
+    }
+}
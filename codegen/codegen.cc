@@ -17,20 +17,19 @@ void Codegen::gen()
     for (auto &statement : statements)
     {
         assert(statement->isStatementFunc());
-        funcGen(statement.get());
+        funcGen(statement->as<FuncStatement>());
     }
 }
 
-void Codegen::funcGen(Statement *_statement)
+void Codegen::funcGen(FuncStatement *func_statement)
 {
-    FuncStatement *func_statement = 
-        static_cast<FuncStatement*>(_statement);
+    // Variables are resolved to slots beforehand (parser/sema.hh)
+    slots = func_statement->getSlots();
+    slot_regs.assign(slots.size(), nullptr);
+    slot_stores.assign(slots.size(), 0);
 
-    // We need to extract the local variables reference
-    local_vars_ref.push_back(func_statement->getLocalVars());
-    local_vars_tracker.emplace_back();
-
-    auto& func_name = func_statement->getFuncName();
+    auto func_name = func_statement->getFuncName();
+    auto func_sym = func_statement->getFuncSymbol();
     auto& func_args = func_statement->getFuncArgs();
     auto& func_codes = func_statement->getFuncCodes();
 
@@ -79,18 +78,18 @@ void Codegen::funcGen(Statement *_statement)
    
     // Create a new basic block to start insertion into.
     BasicBlock *BB = BasicBlock::Create(*context, "", ir_gen_func);
-    builder->SetInsertPoint(BB);
+    startBlock(BB);
 
     // Generate the code section
     // (1) Allocate space for arguments
     auto i = 0;
     std::vector<ValueType::Type> func_arg_types;
     if (ir_gen_func->arg_size())
-        func_arg_types = parser->getFuncArgTypes(func_name);
+        func_arg_types = parser->getFuncArgTypes(func_sym);
     for (auto &arg : ir_gen_func->args())
     {
         Value *val = &arg;
-        Value *reg;
+        AllocaInst *reg;
 
         if (func_arg_types[i] == ValueType::Type::INT)
         {
@@ -103,14 +102,15 @@ void Codegen::funcGen(Statement *_statement)
             builder->CreateStore(val, reg);
 	}
 
-        recordLocalVar(func_args[i].getLiteral(), reg);
+        // arguments hold the first slots
+        slot_regs[i] = reg;
         i++;
     }
 
     // (2) Rest of the codes
     for (auto &statement : func_codes)
     {
-        statementGen(func_name, statement.get());
+        statementGen(func_sym, statement);
     }
 
     if (func_statement->getRetType() == ValueType::Type::VOID)
@@ -122,133 +122,124 @@ void Codegen::funcGen(Statement *_statement)
     // Verify function
     verifyFunction(*ir_gen_func);
 
-    local_vars_tracker.pop_back();
-    local_vars_ref.pop_back();
     num_loops_per_func = 0;
 }
 
-void Codegen::statementGen(std::string &func_name,
-                           Statement* statement)
+// Each frame is a statement and the number of its nested statements
+// generated so far. ifGen/forGen/whileGen emit the code up to the next
+// nested statement and hand it back, so nesting depth costs no native
+// stack.
+void Codegen::statementGen(Symbol func_name,
+                           Statement* root)
 {
-    if (statement->isStatementAssn())
-    {
-        assnGen(statement);
-    }
-    else if (statement->isStatementBuiltinCall())
-    {
-        builtinGen(statement);
-    }
-    else if (statement->isStatementRet())
-    {
-        retGen(func_name, statement);
-    }
-    else if (statement->isStatementNormalCall())
-    {
-        callGen(statement);
-    }
-    else if (statement->isStatementIf())
-    {
-        ifGen(func_name, statement);
-    }
-    else if (statement->isStatementFor())
-    {
-        forGen(func_name, statement);
-    }
-    else if (statement->isStatementWhile())
-    {
-        whileGen(func_name, statement);
+    auto base = statement_frames.size();
+    statement_frames.push_back({root});
+
+    while (statement_frames.size() > base)
+    {
+        auto &frame = statement_frames.back();
+
+        Statement *child = frame.statement->visit(Overloaded{
+            [&](AssnStatement &assn) -> Statement*
+            {
+                assnGen(&assn);
+                return nullptr;
+            },
+            [&](CallStatement &call) -> Statement*
+            {
+                if (call.isBuiltIn())
+                    builtinGen(&call);
+                else
+                    callGen(&call);
+                return nullptr;
+            },
+            [&](RetStatement &ret) -> Statement*
+            {
+                retGen(&ret);
+                return nullptr;
+            },
+            [&](IfStatement &if_s) { return ifGen(func_name, &if_s, frame); },
+            [&](ForStatement &for_s) { return forGen(func_name, &for_s, frame); },
+            [&](WhileStatement &while_s)
+            {
+                return whileGen(func_name, &while_s, frame);
+            },
+            [&](FuncStatement&) -> Statement*
+            {
+                assert(false && "[Error] statementGen: nested function. \n");
+                return nullptr;
+            }
+        });
+
+        if (child == nullptr)
+            statement_frames.pop_back();
+        else
+            statement_frames.push_back({child});
     }
 }
 
-void Codegen::assnGen(Statement *_statement)
+void Codegen::assnGen(AssnStatement *assn_statement)
 {
-    AssnStatement* assn_statement = 
-        static_cast<AssnStatement*>(_statement);
-
-    auto iden = assn_statement->getIden();
     auto expr = assn_statement->getExpr();
 
     // Allocate for identifier
-    std::string var_name;
-    ValueType::Type var_type;
-    Value *reg;
-
-    ArrayExpression* array_info =
-        (expr->isExprArray()) ?
-        static_cast<ArrayExpression*>(expr) :
-        nullptr;
-
-    reg = allocaForIden(var_name, var_type, 
-                        iden, array_info);
+    Value *reg = allocaForIden(assn_statement);
 
     // Extract assigned value    
     Value *val = nullptr;
-    if (array_info != nullptr)
+    if (auto array_info = expr->as<ArrayExpression>())
     {
-        arrayExprGen(var_type, reg, array_info);
+        arrayExprGen(assn_statement->getDeclType(), 
+                     cast<AllocaInst>(reg), array_info);
     }
     else
     {
-        val = exprGen(var_type, expr);
+        val = exprGen(expr);
         builder->CreateStore(val, reg);
     }
+
+    auto iden = assn_statement->getIden();
+    if (auto index = iden->as<IndexExpression>())
+        storedTo(index->getSlot());
+    else
+        storedTo(iden->as<LiteralExpression>()->getSlot());
 }
 
-Value* Codegen::allocaForIden(std::string &var_name, 
-                              ValueType::Type &var_type,
-                              Expression* iden,
-                              ArrayExpression* array_info)
+Value* Codegen::allocaForIden(AssnStatement *assn_statement)
 {
-    // We need to make sure the variable has not been allocated before
-
-    // Determine identifier type
-    if (iden->isExprLiteral())
-    {
-        LiteralExpression *lit = 
-            static_cast<LiteralExpression*>(iden);
-
-        var_name = lit->getLiteral();
-        var_type = getValType(var_name);
-    }
-    else if (iden->isExprIndex())
-    {
-        IndexExpression *index = static_cast<IndexExpression*>(iden);
-	
-        var_name = index->getIden();
-        var_type = getValType(var_name);
-    }
+    auto iden = assn_statement->getIden();
 
     Value *reg;
-    if (auto [is_allocated, reg_base] = getReg(var_name);
-            !is_allocated)
+    if (assn_statement->isDecl())
     {
         // Allocating new variables, must be a literal iden
-        assert(iden->isExprLiteral());
-        LiteralExpression *lit = 
-            static_cast<LiteralExpression*>(iden);
+        auto lit = iden->as<LiteralExpression>();
+        assert(lit != nullptr);
 
+        auto var_type = assn_statement->getDeclType();
+        AllocaInst *alloca;
         if (var_type == ValueType::Type::INT)
         {
-            reg = builder->CreateAlloca(Type::getInt32Ty(*context));
+            alloca = builder->CreateAlloca(Type::getInt32Ty(*context));
         }
         else if (var_type == ValueType::Type::FLOAT)
         {
-            reg = builder->CreateAlloca(Type::getFloatTy(*context));
+            alloca = builder->CreateAlloca(Type::getFloatTy(*context));
         }
         else if (var_type == ValueType::Type::INT_ARRAY || 
                  var_type == ValueType::Type::FLOAT_ARRAY)
         {
+            auto array_info = assn_statement->getExpr()->as<ArrayExpression>();
             assert(array_info != nullptr);
 
             // Extract number of elements
             auto num_ele_expr = array_info->getNumElements();
             assert(num_ele_expr->isExprLiteral());
 
-            auto num_ele_lit = 
-                static_cast<LiteralExpression*>(num_ele_expr);
+            auto num_ele_lit = num_ele_expr->as<LiteralExpression>();
             assert(num_ele_lit->isLiteralInt());
     
-            auto num_ele_int = stoi(num_ele_lit->getLiteral());
+            auto num_ele_int = num_ele_lit->getInt();
 
             // Get array type
             Type *ele_type = (var_type == ValueType::Type::INT_ARRAY) ?
@@ -257,31 +248,35 @@ Value* Codegen::allocaForIden(std::string &var_name,
 
             ArrayType* array_type = ArrayType::get(ele_type, num_ele_int);
 
-            reg = builder->CreateAlloca(array_type);
+            alloca = builder->CreateAlloca(array_type);
         }
         else
         {
 	    std::cerr << "[Error] unsupported allocation type for "
-                      << var_name << "\n";
+                      << symbolName(lit->getSymbol()) << "\n";
             exit(0);
         }
 
-        recordLocalVar(var_name, reg);
+        slot_regs[lit->getSlot()] = alloca;
+        reg = alloca;
     }
     else
     {
-        if (iden->isExprIndex())
+        if (auto index = iden->as<IndexExpression>())
         {
-            IndexExpression *index = static_cast<IndexExpression*>(iden);
-            Value *idx = exprGen(ValueType::Type::INT, index->getIndex());
+            auto reg_base = slotReg(index->getSlot());
+            Value *idx = exprGen(index->getIndex());
             std::vector<Value*> idxs;
             idxs.push_back(ConstantInt::get(*context, APInt(32, 0)));
             idxs.push_back(idx);
-            reg = builder->CreateInBoundsGEP(reg_base, idxs);
+            reg = builder->CreateInBoundsGEP(reg_base->getAllocatedType(),
+                                             reg_base, idxs);
         }
-        else if (iden->isExprLiteral())
+        else
         {
-            reg = reg_base;
+            auto lit = iden->as<LiteralExpression>();
+            assert(lit != nullptr);
+            reg = slotReg(lit->getSlot());
         }
     }
 
@@ -293,33 +288,27 @@ Value* Codegen::allocaForIden(std::string &var_name,
 // This one is bit different from our callGen implementation
 // since we are defining printVarInt/printVarFloat at current
 // compilation unit.
-void Codegen::builtinGen(Statement *_statement)
+void Codegen::builtinGen(CallStatement *built_in_statement)
 {
-    static FunctionCallee printVarInt = 
+    FunctionCallee printVarInt = 
         module->getOrInsertFunction("printVarInt",
             Type::getVoidTy(*context), 
             Type::getInt32Ty(*context));
 
-    static FunctionCallee printVarFloat = 
+    FunctionCallee printVarFloat = 
         module->getOrInsertFunction("printVarFloat",
             Type::getVoidTy(*context), 
             Type::getFloatTy(*context));
-    
-    CallStatement *built_in_statement = 
-        static_cast<CallStatement*>(_statement);
 
     auto call_expr = built_in_statement->getCallExpr();
-    assert(call_expr->isExprCall());
+    assert(call_expr != nullptr);
 
-    auto &func_name = call_expr->getCallFunc();
+    auto func_name = call_expr->getCallFunc();
     auto &func_args = call_expr->getArgs();
     assert(func_args.size() == 1);
-    auto expr = func_args[0].get();
-
-    ValueType::Type var_type = (func_name == "printVarInt") ? 
-        ValueType::Type::INT : ValueType::Type::FLOAT;
+    auto expr = func_args[0];
 
-    Value *val = exprGen(var_type, expr);
+    Value *val = exprGen(expr);
     
     if (func_name == "printVarInt")
     {
@@ -331,27 +320,18 @@ void Codegen::builtinGen(Statement *_statement)
     }
 }
 
-void Codegen::callGen(Statement *_statement)
+void Codegen::callGen(CallStatement *call_statement)
 {
-     CallStatement *built_in_statement = 
-        static_cast<CallStatement*>(_statement);
-
-    auto call_expr = built_in_statement->getCallExpr();
-    assert(call_expr->isExprCall());
+    assert(call_statement->getCallExpr() != nullptr);
 
-    callExprGen(call_expr);
+    exprGen(call_statement->getExpr());
 }
 
-void Codegen::retGen(std::string &cur_func_name,
-                     Statement *_statement)
+void Codegen::retGen(RetStatement *ret)
 {
-    RetStatement* ret = static_cast<RetStatement*>(_statement);
-
     auto expr = ret->getRetVal();
 
-    ValueType::Type ret_type = parser->getFuncRetType(cur_func_name);
-
-    Value *val = exprGen(ret_type, expr);
+    Value *val = exprGen(expr);
     builder->CreateRet(val);
 }
 
@@ -359,8 +339,8 @@ Value* Codegen::condGen(Condition *cond)
 {
     auto var_type = cond->getType();
 
-    Value *left = exprGen(var_type, cond->getLeft());
-    Value *right = exprGen(var_type, cond->getRight());
+    Value *left = exprGen(cond->getLeft());
+    Value *right = exprGen(cond->getRight());
 
     Value* eval = nullptr;
     auto opr = cond->getOpr();
@@ -423,11 +403,11 @@ Value* Codegen::condGen(Condition *cond)
     {
         if (var_type == ValueType::Type::INT)
         {
-            eval = builder->CreateICmpSLT(left, right);
+            eval = builder->CreateICmpSLE(left, right);
         }
         else if (var_type == ValueType::Type::FLOAT)
         {
-            eval = builder->CreateFCmpOLT(left, right);
+            eval = builder->CreateFCmpOLE(left, right);
         }
     }
 
@@ -435,237 +415,315 @@ Value* Codegen::condGen(Condition *cond)
     return eval;
 }
 
-void Codegen::ifGen(std::string& parent_func_name, Statement *_statement)
+Statement* Codegen::ifGen(Symbol parent_func_name, IfStatement *if_s,
+                          StatementFrame &frame)
 {
-    IfStatement *if_s = 
-        static_cast<IfStatement*>(_statement);
-
-    auto cond = condGen(if_s->getCond());
     auto &taken_block = if_s->getTakenBlock();
     auto &not_taken_block = if_s->getNotTakenBlock();
+    auto step = frame.step++;
 
-    // Build basic blocks for paths
-    Function *func = builder->GetInsertBlock()->getParent();
-    BasicBlock *taken_BB =
-        BasicBlock::Create(*context, "", func);
+    if (step == 0)
+    {
+        auto cond = condGen(if_s->getCond());
 
-    BasicBlock *not_taken_BB = (not_taken_block.size()) ?
-                               BasicBlock::Create(*context, "", func) :
-                               nullptr;
+        // Build basic blocks for paths
+        Function *func = builder->GetInsertBlock()->getParent();
+        BasicBlock *taken_BB =
+            BasicBlock::Create(*context, "", func);
 
-    BasicBlock *merge_BB = BasicBlock::Create(*context, "", func);
+        frame.next_BB = (not_taken_block.size()) ?
+                        BasicBlock::Create(*context, "", func) :
+                        nullptr;
 
-    if (not_taken_BB != nullptr)
-    {
-        builder->CreateCondBr(cond, taken_BB, not_taken_BB);
-    }
-    else
-    {
-        builder->CreateCondBr(cond, taken_BB, merge_BB);
-    }
+        frame.merge_BB = BasicBlock::Create(*context, "", func);
 
-    // Build the taken path
-    builder->SetInsertPoint(taken_BB);
-    local_vars_ref.push_back(if_s->getTakenBlockVars());
-    local_vars_tracker.emplace_back();
-    for (auto &statement : taken_block)
-    {
-        statementGen(parent_func_name, statement.get());
+        if (frame.next_BB != nullptr)
+        {
+            builder->CreateCondBr(cond, taken_BB, frame.next_BB);
+        }
+        else
+        {
+            builder->CreateCondBr(cond, taken_BB, frame.merge_BB);
+        }
+
+        // Build the taken path
+        startBlock(taken_BB);
     }
-    builder->CreateBr(merge_BB);
-    local_vars_ref.pop_back();
-    local_vars_tracker.pop_back();
+    if (step < taken_block.size()) return taken_block[step];
 
-    // Build the not
-    if (not_taken_BB != nullptr)
+    step -= taken_block.size();
+    if (step == 0)
     {
-        builder->SetInsertPoint(not_taken_BB);
-        local_vars_ref.push_back(if_s->getNotTakenBlockVars());
-        local_vars_tracker.emplace_back();
-        for (auto &statement : not_taken_block)
-        {
-            statementGen(parent_func_name, statement.get());
-        }
-        builder->CreateBr(merge_BB);
-        local_vars_ref.pop_back();
-        local_vars_tracker.pop_back();
+        builder->CreateBr(frame.merge_BB);
+
+        // Build the not
+        if (frame.next_BB != nullptr) startBlock(frame.next_BB);
     }
+    if (step < not_taken_block.size()) return not_taken_block[step];
 
-    builder->SetInsertPoint(merge_BB);
+    if (frame.next_BB != nullptr) builder->CreateBr(frame.merge_BB);
+    startBlock(frame.merge_BB);
+    return nullptr;
 }
 
-void Codegen::whileGen(std::string& parent_func_name, Statement *_statement)
+// Blocks of a loop, the condition is generated into the header
+void Codegen::loopHeaderGen(Symbol parent_func_name, Condition *end,
+                            StatementFrame &frame)
 {
-    WhileStatement *while_s = 
-        static_cast<WhileStatement*>(_statement);
-
-    local_vars_ref.push_back(while_s->getBlockVars());
-    local_vars_tracker.emplace_back();
-
     // Build basic blocks for paths
     Function *func = builder->GetInsertBlock()->getParent();
+    auto func_label = symbolName(parent_func_name);
 
     BasicBlock *check_BB =
-        BasicBlock::Create(*context, parent_func_name + "_loop_header", func);
+        BasicBlock::Create(*context, func_label + "_loop_header", func);
 
     BasicBlock *body_BB =
-        BasicBlock::Create(*context, parent_func_name + "_loop_body", func);
+        BasicBlock::Create(*context, func_label + "_loop_body", func);
 
     BasicBlock *merge_BB =
-        BasicBlock::Create(*context, parent_func_name + "_after_loop", func);
+        BasicBlock::Create(*context, func_label + "_after_loop", func);
 
     // Gen end (condition)
     builder->CreateBr(check_BB);
-    builder->SetInsertPoint(check_BB);
+    startBlock(check_BB);
 
-    auto end_cond = condGen(while_s->getEnd());
+    auto end_cond = condGen(end);
     builder->CreateCondBr(end_cond, body_BB, merge_BB);
     
     // Gen boday
-    builder->SetInsertPoint(body_BB);
-    auto block = while_s->getBlock();
-    for (auto code : block)
-    {
-        statementGen(parent_func_name, code.get());
-    }
-    builder->CreateBr(check_BB);
-
-    // Loop end
-    builder->SetInsertPoint(merge_BB);
+    startBlock(body_BB);
 
-    local_vars_ref.pop_back();
-    local_vars_tracker.pop_back();
+    frame.next_BB = check_BB;
+    frame.merge_BB = merge_BB;
 }
 
-void Codegen::forGen(std::string& parent_func_name, Statement *_statement)
+Statement* Codegen::whileGen(Symbol parent_func_name, WhileStatement *while_s,
+                             StatementFrame &frame)
 {
-    ForStatement *for_s = 
-        static_cast<ForStatement*>(_statement);
+    auto &block = while_s->getBlock();
+    auto step = frame.step++;
 
-    local_vars_ref.push_back(for_s->getBlockVars());
-    local_vars_tracker.emplace_back();
+    if (step == 0) loopHeaderGen(parent_func_name, while_s->getEnd(), frame);
+    if (step < block.size()) return block[step];
 
-    // Gen start
-    assnGen(for_s->getStart());
+    builder->CreateBr(frame.next_BB);
 
-    // Build basic blocks for paths
-    Function *func = builder->GetInsertBlock()->getParent();
-
-    BasicBlock *check_BB =
-        BasicBlock::Create(*context, parent_func_name + "_loop_header", func);
-
-    BasicBlock *body_BB =
-        BasicBlock::Create(*context, parent_func_name + "_loop_body", func);
-
-    BasicBlock *merge_BB =
-        BasicBlock::Create(*context, parent_func_name + "_after_loop", func);
+    // Loop end
+    startBlock(frame.merge_BB);
+    return nullptr;
+}
 
-    // Gen end (condition)
-    builder->CreateBr(check_BB);
-    builder->SetInsertPoint(check_BB);
+Statement* Codegen::forGen(Symbol parent_func_name, ForStatement *for_s,
+                           StatementFrame &frame)
+{
+    auto &block = for_s->getBlock();
+    auto step = frame.step++;
 
-    auto end_cond = condGen(for_s->getEnd());
-    builder->CreateCondBr(end_cond, body_BB, merge_BB);
-    
-    // Gen boday
-    builder->SetInsertPoint(body_BB);
-    auto block = for_s->getBlock();
-    for (auto code : block)
+    if (step == 0)
     {
-        statementGen(parent_func_name, code.get());
+        // Gen start
+        assnGen(for_s->getStart()->as<AssnStatement>());
+        loopHeaderGen(parent_func_name, for_s->getEnd(), frame);
     }
+    if (step < block.size()) return block[step];
 
     // Gen step
-    assnGen(for_s->getStep());
-    builder->CreateBr(check_BB);
+    assnGen(for_s->getStep()->as<AssnStatement>());
+    builder->CreateBr(frame.next_BB);
 
     // Loop end
-    builder->SetInsertPoint(merge_BB);
-
-    local_vars_ref.pop_back();
-    local_vars_tracker.pop_back();
+    startBlock(frame.merge_BB);
+    return nullptr;
 }
 
-Value* Codegen::exprGen(ValueType::Type _var_type, Expression *expr)
+// Operands before the operator, off a stack of (expression, operands
+// done) rather than by recursion; the values of finished operands wait
+// on value_stack. Operands come in the order the recursive generator
+// had: arithmetic ones left to right, then the rest left to right.
+Value* Codegen::exprGen(Expression *root)
 {
-    ValueType::Type var_type = _var_type;
-    if (_var_type == ValueType::Type::INT_ARRAY)
-        var_type = ValueType::Type::INT;
-    else if (_var_type == ValueType::Type::FLOAT_ARRAY)
-        var_type = ValueType::Type::FLOAT;
+    auto base = expr_frames.size();
+    expr_frames.push_back({root, false});
 
-    Value *val = nullptr;
-    if (expr->isExprLiteral())
+    while (expr_frames.size() > base)
     {
-        LiteralExpression* lit = static_cast<LiteralExpression*>(expr);
+        auto [expr, operands_done] = expr_frames.back();
+        expr_frames.pop_back();
 
-        val = literalExprGen(var_type, lit);
-    }
-    else if (expr->isExprArith())
-    {
-        ArithExpression *arith = static_cast<ArithExpression *>(expr);
+        if (!operands_done)
+        {
+            if (reuse_values)
+            {
+                if (auto val = reusedValue(expr))
+                {
+                    value_stack.push_back(val);
+                    continue;
+                }
+            }
+
+            // Pushed in reverse, the last one pushed goes first
+            expr_frames.push_back({expr, true});
+            auto push = [&](Expression *operand)
+                        { expr_frames.push_back({operand, false}); };
+            expr->visit(Overloaded{
+                [&](LiteralExpression&) {},
+                [&](ArithExpression &arith)
+                {
+                    if (rightFirst(&arith))
+                    {
+                        push(arith.getLeft());
+                        push(arith.getRight());
+                    }
+                    else
+                    {
+                        push(arith.getRight());
+                        push(arith.getLeft());
+                    }
+                },
+                [&](IndexExpression &index) { push(index.getIndex()); },
+                [&](CallExpression &call)
+                {
+                    auto &args = call.getArgs();
+                    for (auto iter = args.end(); iter != args.begin(); )
+                        push(*--iter);
+                },
+                // Arrays only appear as initializers, see assnGen
+                [&](ArrayExpression&) {}
+            });
+            continue;
+        }
+
+        // Typed by the semantic pass
+        ValueType::Type var_type = expr->getValueType();
+
+        Value *val = expr->visit(Overloaded{
+            [&](LiteralExpression &lit) { return literalExprGen(&lit); },
+            [&](ArithExpression &arith)
+            {
+                Value *second = popValue();
+                Value *first = popValue();
+                if (rightFirst(&arith)) std::swap(first, second);
+                return arithExprGen(var_type, &arith, first, second);
+            },
+            [&](IndexExpression &index)
+            {
+                return indexExprGen(var_type, &index, popValue());
+            },
+            [&](CallExpression &call)
+            {
+                auto num_args = call.getArgs().size();
+                std::vector<Value*> args(value_stack.end() - num_args,
+                                         value_stack.end());
+                value_stack.resize(value_stack.size() - num_args);
+                return callExprGen(&call, args);
+            },
+            [&](ArrayExpression&) -> Value* { return nullptr; }
+        });
+
+        assert(val != nullptr);
+        if (reuse_values) recordValue(expr, val);
+        value_stack.push_back(val);
+    }
+    return popValue();
+}
+
+Value* Codegen::reusedValue(Expression *expr)
+{
+    auto iter = block_values.find(expr);
+    if (iter == block_values.end()) return nullptr;
 
-        val = arithExprGen(var_type, arith);        
+    for (auto [slot, stores] : iter->second.reads)
+    {
+        if (slot_stores[slot] != stores)
+        {
+            block_values.erase(iter);
+            return nullptr;
+        }
     }
-    else if (expr->isExprIndex())
+    return iter->second.val;
+}
+
+// Operands go through exprGen first, so a reusable operand is in
+// block_values by the time its parent is recorded
+void Codegen::recordValue(Expression *expr, Value *val)
+{
+    BlockValue entry{val, {}};
+
+    auto addRead = [&](uint32_t slot)
     {
-        IndexExpression *index = static_cast<IndexExpression*>(expr);
+        for (auto &read : entry.reads)
+        {
+            if (read.first == slot) return;
+        }
+        entry.reads.push_back({slot, slot_stores[slot]});
+    };
 
-        val = indexExprGen(var_type, index);
-    }
-    else if (expr->isExprCall())
+    // false if the operand is not reusable
+    auto addOperand = [&](Expression *operand)
     {
-        CallExpression *call = static_cast<CallExpression*>(expr);
+        auto lit = operand->as<LiteralExpression>();
+        if (lit != nullptr && !lit->isVariable()) return true;
 
-        val = callExprGen(call);
-    }
+        auto iter = block_values.find(operand);
+        if (iter == block_values.end()) return false;
+        for (auto &read : iter->second.reads) addRead(read.first);
+        return entry.reads.size() <= MAX_REUSE_READS;
+    };
 
-    assert(val != nullptr);
-    return val;
+    bool reusable = expr->visit(Overloaded{
+        [&](LiteralExpression &lit)
+        {
+            // Constants cost nothing to emit again
+            if (!lit.isVariable()) return false;
+            addRead(lit.getSlot());
+            return true;
+        },
+        [&](ArithExpression &arith)
+        {
+            return addOperand(arith.getLeft()) && addOperand(arith.getRight());
+        },
+        [&](IndexExpression &index)
+        {
+            addRead(index.getSlot());
+            return addOperand(index.getIndex());
+        },
+        [&](CallExpression&) { return false; },
+        [&](ArrayExpression&) { return false; }
+    });
+
+    if (reusable && entry.reads.size() <= MAX_REUSE_READS)
+        block_values[expr] = std::move(entry);
 }
 
-Value* Codegen::literalExprGen(ValueType::Type type, 
-                               LiteralExpression* lit)
+Value* Codegen::literalExprGen(LiteralExpression* lit)
 {
-    Value *val;
-    auto [is_allocated, reg_val] = getReg(lit->getLiteral());
+    Value *val = nullptr;
 
-    if (!is_allocated)
+    if (!lit->isVariable())
     {
         assert((lit->isLiteralInt() || 
                 lit->isLiteralFloat()));
 
-        auto val_str = lit->getLiteral();
         if (lit->isLiteralInt())
         {
-            val = ConstantInt::get(*context, APInt(32, stoi(val_str)));
+            val = ConstantInt::get(*context, APInt(32, lit->getInt()));
         }
         else if (lit->isLiteralFloat())
         {
-            val = ConstantFP::get(*context, APFloat(stof(val_str)));
+            val = ConstantFP::get(*context, APFloat(lit->getFloat()));
         }
     }
     else
     {
-        if (type == ValueType::Type::INT)
-        {
-            val = builder->CreateLoad(Type::getInt32Ty(*context),
-                                      reg_val);
-            
-        }
-        else if (type == ValueType::Type::FLOAT)
-        {
-            val = builder->CreateLoad(Type::getFloatTy(*context),
-                                      reg_val);
-            
-        }
+        auto reg_val = slotReg(lit->getSlot());
+        val = builder->CreateLoad(reg_val->getAllocatedType(), reg_val);
     }
     assert(val != nullptr);
     return val;
 }
 
 void Codegen::arrayExprGen(ValueType::Type array_type,
-                           Value *reg,
+                           AllocaInst *reg,
                            ArrayExpression* array_info)
 {
     // Determine element type
@@ -684,78 +742,32 @@ void Codegen::arrayExprGen(ValueType::Type array_type,
     std::vector<Value *> index;
     index.push_back(ConstantInt::get(*context, APInt(32, 0)));
     index.push_back(ConstantInt::get(*context, APInt(32, 0)));
-    auto base = builder->CreateInBoundsGEP(reg, index);
+    auto base = builder->CreateInBoundsGEP(reg->getAllocatedType(), 
+                                           reg, index);
+    Type *ele_type = (type == ValueType::Type::INT) ?
+                     Type::getInt32Ty(*context) :
+                     Type::getFloatTy(*context);
 
     auto cnt = 0;
     auto last_ele_idx = array_info->getElements().size() - 1;
     auto const_one = ConstantInt::get(*context, APInt(32, 1));
     for (auto ele : array_info->getElements())
     {
-        Value *val = exprGen(type, ele.get());
+        Value *val = exprGen(ele);
         builder->CreateStore(val, base);
         if (++cnt <= last_ele_idx)
         {
             // increment one to the base
-            base = builder->CreateInBoundsGEP(base, const_one); 
+            base = builder->CreateInBoundsGEP(ele_type, base, const_one); 
         }
     }
 }
 
 Value* Codegen::arithExprGen(ValueType::Type type, 
-                             ArithExpression* arith)
+                             ArithExpression* arith,
+                             Value *val_left,
+                             Value *val_right)
 {
-    Value *val_left = nullptr;
-    Value *val_right = nullptr;
-
-    // Recursively generate the left arith expr
-    if (arith->getLeft() != nullptr)
-    {
-        Expression *next_expr = arith->getLeft();
-        if (next_expr->isExprArith())
-        {
-            ArithExpression* next_arith = 
-                static_cast<ArithExpression*>(next_expr);
-            val_left = arithExprGen(type, 
-                                    next_arith);
-        }
-    }
-
-    // Recursively generate the right arith expr
-    if (arith->getRight() != nullptr)
-    {
-        Expression *next_expr = arith->getRight();
-        if (next_expr->isExprArith())
-        {
-            ArithExpression* next_arith = 
-                static_cast<ArithExpression*>(next_expr);
-            val_right = arithExprGen(type,
-                                     next_arith);
-        }
-    }
-
-    if (val_left == nullptr)
-    {
-        Expression *left_expr = arith->getLeft();
-
-        assert((left_expr->isExprLiteral() || 
-                left_expr->isExprCall() || 
-                left_expr->isExprIndex()));
-
-        val_left = exprGen(type, left_expr);
-    }
-
-    if (val_right == nullptr)
-    {
-        Expression *right_expr = arith->getRight();
-
-        // The right_expr must either be literal or call
-	assert((right_expr->isExprLiteral() || 
-                right_expr->isExprCall() ||
-                right_expr->isExprIndex()));
-
-        val_right = exprGen(type, right_expr);
-    }
-
     assert(val_left != nullptr);
     assert(val_right != nullptr);
 
@@ -788,17 +800,16 @@ Value* Codegen::arithExprGen(ValueType::Type type,
 }
 
 Value* Codegen::indexExprGen(ValueType::Type type, 
-                             IndexExpression* index)
+                             IndexExpression* index,
+                             Value *idx)
 {
-    auto [is_allocated, reg_val] = getReg(index->getIden());
-    assert(is_allocated);
-
-    Value *idx = exprGen(ValueType::Type::INT, index->getIndex());
+    auto reg_val = slotReg(index->getSlot());
 
     std::vector<Value*> idxs;
     idxs.push_back(ConstantInt::get(*context, APInt(32, 0)));
     idxs.push_back(idx);
-    auto base = builder->CreateInBoundsGEP(reg_val, idxs);
+    auto base = builder->CreateInBoundsGEP(reg_val->getAllocatedType(),
+                                           reg_val, idxs);
 
     Value *val;
     if (type == ValueType::Type::INT)
@@ -809,9 +820,10 @@ Value* Codegen::indexExprGen(ValueType::Type type,
     return val;
 }
 
-Value* Codegen::callExprGen(CallExpression *call)
+Value* Codegen::callExprGen(CallExpression *call,
+                            std::vector<Value*> &call_func_args)
 {
-    auto &def = call->getCallFunc();
+    auto def = call->getCallFunc();
     Function *call_func = module->getFunction(def);
     if (!call_func)
     {
@@ -819,28 +831,8 @@ Value* Codegen::callExprGen(CallExpression *call)
         exit(0);
     }
 
-    auto args = call->getArgs();
-    auto arg_types = parser->getFuncArgTypes(def);
-    assert(args.size() == call_func->arg_size());
-    assert(arg_types.size() == call_func->arg_size());
-
-    std::vector<Value*> call_func_args;
-    for (auto i = 0; i < call_func->arg_size(); i++)
-    {
-        auto expr = args[i].get();
-
-        Value *val = exprGen(arg_types[i], expr);
-        call_func_args.push_back(val);
-    }
+    assert(call_func_args.size() == call_func->arg_size());
 
     return builder->CreateCall(call_func, call_func_args);
 }
-
-void Codegen::print()
-{
-    module->print(errs(), nullptr);
-    std::error_code EC;
-    raw_fd_ostream out(out_fn, EC);
-    WriteBitcodeToFile(*module, out);
-}
 }
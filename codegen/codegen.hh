@@ -16,6 +16,11 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace llvm;
 
@@ -70,6 +75,14 @@ class Codegen
     std::string mod_name;
     std::string out_fn;
 
+    // empty - util/print.bc next to the codegen binary
+    std::string runtime_fn;
+
+    unsigned opt_level = 0;
+    std::string pass_pipeline;
+
+    bool dump_ir = false;
+
     Parser* parser;
 
     size_t num_loops_per_func = 0;
@@ -87,85 +100,192 @@ class Codegen
         parser = _parser;
     }
 
+    // Emit a shared expression (parser/parser.hh, share_exprs) once per
+    // basic block and use its value from then on
+    void setReuseValues(bool _reuse_values)
+    {
+        reuse_values = _reuse_values;
+    }
+
+    // Runtime bitcode (util/print.c) linked into native outputs, by
+    // default the util/print.bc beside the binary
+    void setRuntime(const char *_runtime_fn)
+    {
+        runtime_fn = _runtime_fn;
+    }
+
+    // Optimize at -O<level>, 0 to 3, with the default new pass manager
+    // pipeline. Passes, in opt -passes syntax, run instead of the default
+    // pipeline when given; the level still sets the backend's effort.
+    void setOptLevel(unsigned _opt_level)
+    {
+        opt_level = _opt_level;
+    }
+
+    void setPasses(const char *_pass_pipeline)
+    {
+        pass_pipeline = _pass_pipeline;
+    }
+
+    // Have emit/run print the module as they compile it - optimized, and
+    // for .o/.s linked with the runtime
+    void setDumpIR(bool _dump_ir)
+    {
+        dump_ir = _dump_ir;
+    }
+
     void gen();
 
+    // Dump the module as text to stderr
     void print();
 
+    // Write the module to out_fn, by its extension - .o object or .s
+    // assembly for the host, linked with the runtime; .ll text IR;
+    // bitcode otherwise
+    void emit();
+
+    // Compile a copy of the module at every level (and the custom
+    // pipeline), print the time each took and the code it made to stderr
+    void optReport();
+
+    // JIT compile the module and run main in this process, its return
+    // value. Functions compile on their first call. Takes the module,
+    // print cannot follow.
+    int32_t run();
+
   protected:
-    std::vector<std::unordered_map<std::string,
-                                   ValueType::Type>*> local_vars_ref;
-    std::vector<std::unordered_map<std::string,Value*>> local_vars_tracker;
+    enum class Output { OBJECT, ASSEMBLY, IR, BITCODE };
+    Output outputKind();
+    void linkRuntime();
+    // The host, initialized for JIT or emission
+    std::unique_ptr<TargetMachine> hostMachine(unsigned level);
+    // The backend works as hard as llc -O<level>
+    static CodeGenOpt::Level backendLevel(unsigned level)
+    {
+        static const CodeGenOpt::Level levels[] =
+        {
+            CodeGenOpt::None, CodeGenOpt::Less,
+            CodeGenOpt::Default, CodeGenOpt::Aggressive
+        };
+        return levels[level];
+    }
+    void emitNative(Module &mod, TargetMachine &machine,
+                    raw_pwrite_stream &out, bool assembly);
 
-    void recordLocalVar(std::string& var_name, Value* reg)
+    bool optimizing() { return opt_level > 0 || !pass_pipeline.empty(); }
+    void optimize(Module &mod, TargetMachine &machine, unsigned level,
+                  const std::string &pipeline);
+
+    // Variables of the function being generated, by slot (see
+    // parser/sema.hh) - their types, and their allocas once declared
+    ArenaSpan<LocalSlot> slots;
+    std::vector<AllocaInst*> slot_regs;
+
+    // Name of an identifier symbol (LLVM names, block labels, errors)
+    std::string_view symbolName(Symbol sym)
     {
-        auto &tracker = local_vars_tracker.back();
-        tracker.insert({var_name, reg});
+        return parser->getSymbols().name(sym);
     }
 
-    ValueType::Type getValType(std::string& _var_name)
+    AllocaInst* slotReg(uint32_t slot)
     {
-        for (int i = local_vars_ref.size() - 1;
-                 i >= 0;
-                 i--)
-        {
-            auto &ref = local_vars_ref[i];
-
-            if (auto iter = ref->find(_var_name);
-                    iter != ref->end())
-            {
-                return iter->second;
-            }
-        }
+        assert(slot < slot_regs.size() && slot_regs[slot] != nullptr);
+        return slot_regs[slot];
     }
-    
-    std::pair<bool,Value*> getReg(std::string& _var_name)
+
+    // Value reuse - the value of each side-effect-free expression emitted
+    // in the current basic block, with the slots it read and how many
+    // stores each had seen then. A store to one of them since makes the
+    // value stale. Calls are never reused; they cannot store to the
+    // caller's variables, so they kill nothing either.
+    struct BlockValue
     {
-        for (int i = local_vars_tracker.size() - 1;
-                 i >= 0;
-                 i--)
-        {
-            auto &tracker = local_vars_tracker[i];
-
-            if (auto iter = tracker.find(_var_name);
-                    iter != tracker.end())
-            {
-                return std::make_pair(true,iter->second);
-            }
-        }
-        return std::make_pair(false,nullptr);
+        Value *val;
+        std::vector<std::pair<uint32_t,uint32_t>> reads;
+    };
+
+    // Wider expressions are re-emitted, keeps the bookkeeping linear
+    static constexpr size_t MAX_REUSE_READS = 16;
+
+    bool reuse_values = false;
+    std::unordered_map<Expression*, BlockValue> block_values;
+    std::vector<uint32_t> slot_stores;
+
+    Value* reusedValue(Expression*);
+    void recordValue(Expression*, Value*);
+    void storedTo(uint32_t slot) { slot_stores[slot]++; }
+
+    // Values do not carry over from one block to the next
+    void startBlock(BasicBlock *BB)
+    {
+        builder->SetInsertPoint(BB);
+        block_values.clear();
     }
 
-    void statementGen(std::string&, Statement*);
+    // A statement partway through generation - the nested statements done
+    // so far, and the blocks an if or loop still has to emit into
+    struct StatementFrame
+    {
+        Statement *statement;
+        size_t step = 0;
+        // if - the else block; loop - the header
+        BasicBlock *next_BB = nullptr;
+        BasicBlock *merge_BB = nullptr;
+    };
+    std::vector<StatementFrame> statement_frames;
+
+    // (expression, operands done) and the operand values, see exprGen
+    std::vector<std::pair<Expression*,bool>> expr_frames;
+    std::vector<Value*> value_stack;
+
+    Value* popValue()
+    {
+        auto val = value_stack.back();
+        value_stack.pop_back();
+        return val;
+    }
 
-    void funcGen(Statement *);
-    void assnGen(Statement *);
-    void builtinGen(Statement *);
-    void callGen(Statement *);
-    void retGen(std::string &,Statement *);
+    // The order arithExprGen always took operands in: an arithmetic right
+    // operand goes before a plain left one
+    static bool rightFirst(ArithExpression *arith)
+    {
+        return !arith->getLeft()->isExprArith() &&
+               arith->getRight()->isExprArith();
+    }
+
+    void statementGen(Symbol, Statement*);
+
+    void funcGen(FuncStatement *);
+    void assnGen(AssnStatement *);
+    void builtinGen(CallStatement *);
+    void callGen(CallStatement *);
+    void retGen(RetStatement *);
+
+    // Emit up to the next nested statement and return it, nullptr once
+    // the statement is done
+    Statement* ifGen(Symbol, IfStatement *, StatementFrame &);
+    Statement* forGen(Symbol, ForStatement *, StatementFrame &);
+    Statement* whileGen(Symbol, WhileStatement *, StatementFrame &);
+    void loopHeaderGen(Symbol, Condition *, StatementFrame &);
 
     Value* condGen(Condition*);
-    void ifGen(std::string&,Statement *);
-    void forGen(std::string&,Statement *);
-    void whileGen(std::string&,Statement *);
-
-    Value* allocaForIden(std::string&,
-                         ValueType::Type&,
-                         Expression*,
-                         ArrayExpression*);
+
+    Value* allocaForIden(AssnStatement*);
    
-    Value* exprGen(ValueType::Type,Expression*);
+    Value* exprGen(Expression*);
 
     void arrayExprGen(ValueType::Type,
-                      Value*,
+                      AllocaInst*,
                       ArrayExpression*);
 
-    Value* arithExprGen(ValueType::Type,ArithExpression*);
+    // Operands are generated by exprGen and passed in
+    Value* arithExprGen(ValueType::Type, ArithExpression*, Value*, Value*);
 
-    Value* literalExprGen(ValueType::Type, LiteralExpression*);
+    Value* literalExprGen(LiteralExpression*);
 
-    Value* indexExprGen(ValueType::Type, IndexExpression*);
+    Value* indexExprGen(ValueType::Type, IndexExpression*, Value*);
 
-    Value* callExprGen(CallExpression*);
+    Value* callExprGen(CallExpression*, std::vector<Value*>&);
 };
 }
 
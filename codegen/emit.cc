@@ -0,0 +1,158 @@
+#include "codegen/codegen.hh"
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include <cstring>
+
+namespace Frontend
+{
+void Codegen::print()
+{
+    module->print(errs(), nullptr);
+}
+
+// What to write, by the extension of out_fn - .o, .s, .ll; anything else
+// is bitcode
+Codegen::Output Codegen::outputKind()
+{
+    auto dot = strrchr(out_fn.c_str(), '.');
+    std::string ext = dot ? dot : "";
+    if (ext == ".o") return Output::OBJECT;
+    if (ext == ".s") return Output::ASSEMBLY;
+    if (ext == ".ll") return Output::IR;
+    return Output::BITCODE;
+}
+
+// util/print.bc beside the running binary, so .o/.s outputs link from
+// any working directory
+static std::string defaultRuntime()
+{
+    static int anchor;
+    auto exe = sys::fs::getMainExecutable("codegen", &anchor);
+    SmallString<256> path(sys::path::parent_path(exe));
+    sys::path::append(path, "util", "print.bc");
+    return std::string(path.str());
+}
+
+void Codegen::linkRuntime()
+{
+    if (runtime_fn.empty()) runtime_fn = defaultRuntime();
+
+    auto buf = MemoryBuffer::getFile(runtime_fn);
+    if (!buf)
+    {
+        std::cerr << "[Error] cannot read runtime " << runtime_fn << ": "
+                  << buf.getError().message() << "\n";
+        exit(0);
+    }
+
+    auto runtime = parseBitcodeFile((*buf)->getMemBufferRef(), *context);
+    if (!runtime)
+    {
+        std::cerr << "[Error] runtime " << runtime_fn << ": "
+                  << toString(runtime.takeError()) << "\n";
+        exit(0);
+    }
+
+    // The runtime is built for the host already; take its triple and
+    // layout before linking so the two agree
+    module->setTargetTriple((*runtime)->getTargetTriple());
+    module->setDataLayout((*runtime)->getDataLayout());
+
+    // Both go into an empty module, as llvm-link does it - internal
+    // functions nothing calls are left out
+    auto linked = std::make_unique<Module>(mod_name, *context);
+    Linker linker(*linked);
+    if (linker.linkInModule(std::move(module)) ||
+        linker.linkInModule(std::move(*runtime)))
+    {
+        std::cerr << "[Error] cannot link runtime " << runtime_fn << "\n";
+        exit(0);
+    }
+    module = std::move(linked);
+}
+
+std::unique_ptr<TargetMachine> Codegen::hostMachine(unsigned level)
+{
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+
+    std::string triple = sys::getDefaultTargetTriple();
+    std::string error;
+    auto target = TargetRegistry::lookupTarget(triple, error);
+    if (!target)
+    {
+        std::cerr << "[Error] no target for " << triple << ": " << error << "\n";
+        exit(0);
+    }
+
+    // Position independent, so the object links into the PIE executables
+    // compilers build by default
+    return std::unique_ptr<TargetMachine>(
+        target->createTargetMachine(triple, "generic", "", TargetOptions(),
+                                    Reloc::PIC_, None, backendLevel(level)));
+}
+
+void Codegen::emitNative(Module &mod, TargetMachine &machine,
+                         raw_pwrite_stream &out, bool assembly)
+{
+    legacy::PassManager passes;
+    auto type = assembly ? CGFT_AssemblyFile : CGFT_ObjectFile;
+    if (machine.addPassesToEmitFile(passes, out, nullptr, type))
+    {
+        std::cerr << "[Error] " << machine.getTargetTriple().str()
+                  << " cannot emit this file type\n";
+        exit(0);
+    }
+    passes.run(mod);
+}
+
+void Codegen::emit()
+{
+    auto kind = outputKind();
+    bool native = kind == Output::OBJECT || kind == Output::ASSEMBLY;
+
+    // Only native code is linked with the runtime; .ll and .bc are the
+    // program alone, as llvm-link and bc_compile.bash expect
+    if (native) linkRuntime();
+
+    // Unoptimized IR is written as generated; anything else is laid out
+    // for the host first
+    std::unique_ptr<TargetMachine> machine;
+    if (native || optimizing())
+    {
+        machine = hostMachine(opt_level);
+        module->setTargetTriple(machine->getTargetTriple().str());
+        module->setDataLayout(machine->createDataLayout());
+    }
+    if (optimizing()) optimize(*module, *machine, opt_level, pass_pipeline);
+    if (dump_ir) print();
+
+    std::error_code EC;
+    raw_fd_ostream out(out_fn, EC,
+                       kind == Output::IR || kind == Output::ASSEMBLY
+                           ? sys::fs::OF_Text : sys::fs::OF_None);
+    if (EC)
+    {
+        std::cerr << "[Error] cannot open " << out_fn << ": "
+                  << EC.message() << "\n";
+        exit(0);
+    }
+
+    if (native)
+        emitNative(*module, *machine, out, kind == Output::ASSEMBLY);
+    else if (kind == Output::IR)
+        module->print(out, nullptr);
+    else
+        WriteBitcodeToFile(*module, out);
+}
+}
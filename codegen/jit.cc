@@ -0,0 +1,115 @@
+#include "codegen/codegen.hh"
+
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include <cstdio>
+
+using namespace llvm::orc;
+
+namespace Frontend
+{
+// The runtime, as util/print.c. The JIT binds printVarInt/printVarFloat
+// to these instead of linking util/print.bc.
+static void runtimePrintVarInt(int32_t x)
+{
+    printf("%d\n", x);
+}
+
+static void runtimePrintVarFloat(float x)
+{
+    printf("%f\n", x);
+}
+
+// Threads the JIT compiles on. With one, partitions can share the
+// module's context instead of each being cloned into one of its own; that
+// is only safe while no two of them are ever compiled at once.
+static constexpr unsigned JIT_COMPILE_THREADS = 1;
+
+// Unwraps an LLVM result, any error is fatal
+template<typename T>
+static T jitCheck(Expected<T> val, const char *what)
+{
+    if (!val)
+    {
+        std::cerr << "[Error] " << what << ": "
+                  << toString(val.takeError()) << "\n";
+        exit(0);
+    }
+    return std::move(*val);
+}
+
+static void jitCheck(Error err, const char *what)
+{
+    if (err)
+    {
+        std::cerr << "[Error] " << what << ": "
+                  << toString(std::move(err)) << "\n";
+        exit(0);
+    }
+}
+
+int32_t Codegen::run()
+{
+    // The JIT takes the module, and its context with it
+    if (verifyModule(*module, &errs()))
+    {
+        std::cerr << "[Error] generated module is broken, cannot run it\n";
+        exit(0);
+    }
+
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+
+    // The whole module is optimized up front, what is left of it still
+    // compiles lazily, with the backend at the same level
+    if (optimizing())
+    {
+        auto machine = hostMachine(opt_level);
+        module->setTargetTriple(machine->getTargetTriple().str());
+        module->setDataLayout(machine->createDataLayout());
+        optimize(*module, *machine, opt_level, pass_pipeline);
+    }
+    if (dump_ir) print();
+
+    auto host = jitCheck(JITTargetMachineBuilder::detectHost(), "JIT setup");
+    host.setCodeGenOptLevel(backendLevel(opt_level));
+    // Compiling happens on a thread of its own. A function's first call
+    // waits for it there, so the compiler never runs on top of the calls
+    // the program has in progress, however deep they go.
+    auto jit = jitCheck(LLLazyJITBuilder()
+                            .setJITTargetMachineBuilder(std::move(host))
+                            .setNumCompileThreads(JIT_COMPILE_THREADS)
+                            .create(),
+                        "JIT setup");
+
+    // Every function is its own partition, compiled on its first call;
+    // main is compiled before it starts, its callees as they are reached
+    jit->setPartitionFunction(CompileOnDemandLayer::compileRequested);
+    // Sharing the module's context is only safe with a single compile
+    // thread, see JIT_COMPILE_THREADS
+    jit->getCompileOnDemandLayer().setCloneToNewContextOnEmit(
+        JIT_COMPILE_THREADS != 1);
+
+    auto &lib = jit->getMainJITDylib();
+    MangleAndInterner mangle(jit->getExecutionSession(), jit->getDataLayout());
+    SymbolMap runtime;
+    runtime[mangle("printVarInt")] = JITEvaluatedSymbol(
+        pointerToJITTargetAddress(&runtimePrintVarInt), JITSymbolFlags::Exported);
+    runtime[mangle("printVarFloat")] = JITEvaluatedSymbol(
+        pointerToJITTargetAddress(&runtimePrintVarFloat), JITSymbolFlags::Exported);
+    jitCheck(lib.define(absoluteSymbols(std::move(runtime))), "runtime symbols");
+
+    jitCheck(jit->addLazyIRModule(ThreadSafeModule(std::move(module),
+                                                   std::move(context))),
+             "adding module");
+
+    auto main_sym = jitCheck(jit->lookup("main"), "looking up main");
+    auto main_func = jitTargetAddressToFunction<int32_t (*)()>(main_sym.getAddress());
+    int32_t ret = main_func();
+    fflush(stdout);
+    return ret;
+}
+}
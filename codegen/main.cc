@@ -1,19 +1,97 @@
 #include "parser/parser.hh"
+#include "parser/fold.hh"
+#include "parser/sema.hh"
 #include "codegen/codegen.hh"
 
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 using namespace Frontend;
 
 int main(int argc, char* argv[])
 {
+    // codegen [options] <source> <out.o|out.s|out.ll|out.bc>
+    // codegen [options] --run <source>
+    //   --cache DIR    - take the AST from the cache in DIR, parse and save
+    //                    it there on a miss
+    //   --no-fold      - emit every operation as written, no constant folding
+    //   --share        - share equal expressions in the AST and emit each
+    //                    one once per basic block
+    //   --dump-ir      - print the module as text to stderr, as it is
+    //                    compiled: after optimizing, and for .o/.s with
+    //                    the runtime linked in
+    //   --runtime FILE - runtime bitcode linked into .o/.s outputs, by
+    //                    default util/print.bc in the directory the
+    //                    codegen binary is in
+    //   -O0..-O3       - optimization level, -O0 by default
+    //   --passes LIST  - run these passes (opt -passes syntax) instead of
+    //                    the level's default pipeline
+    //   --opt-report   - print compile time and code size at every level
+    //                    to stderr
+    //   --run          - JIT compile and run main instead of writing a
+    //                    file, exits with main's return value
+    const char* cache_dir = nullptr;
+    const char* runtime = nullptr;
+    const char* passes = nullptr;
+    unsigned opt_level = 0;
+    bool opt_report = false;
+    bool fold = true;
+    bool share = false;
+    bool dump_ir = false;
+    bool run = false;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--no-fold") == 0)
+            fold = false;
+        else if (strcmp(argv[i], "--share") == 0)
+            share = true;
+        else if (strcmp(argv[i], "--dump-ir") == 0)
+            dump_ir = true;
+        else if (strcmp(argv[i], "--runtime") == 0 && i + 1 < argc)
+            runtime = argv[++i];
+        else if (strlen(argv[i]) == 3 && strncmp(argv[i], "-O", 2) == 0 &&
+                 argv[i][2] >= '0' && argv[i][2] <= '3')
+            opt_level = argv[i][2] - '0';
+        else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+            passes = argv[++i];
+        else if (strcmp(argv[i], "--opt-report") == 0)
+            opt_report = true;
+        else if (strcmp(argv[i], "--run") == 0)
+            run = true;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != (run ? 1 : 2))
+    {
+        std::cerr << "[Error] usage: codegen [--cache DIR] [--no-fold] [--share] [--dump-ir] [--runtime FILE]\n"
+                  << "                      [-O0..-O3] [--passes LIST] [--opt-report] <source> <out.o|out.s|out.ll|out.bc>\n"
+                  << "       codegen [--cache DIR] [--no-fold] [--share] [--dump-ir]\n"
+                  << "               [-O0..-O3] [--passes LIST] [--opt-report] --run <source>\n";
+        exit(0);
+    }
+
     // Parser
-    Parser parser(argv[1]);
+    Parser parser(files[0], false, 1, cache_dir, share);
+
+    // AST passes
+    if (fold) ASTFolder(parser.getProgram()).foldProgram();
+    Sema(parser).run();
 
     // LLVM IR generation
-    Codegen codegen(argv[1], argv[2]);
+    Codegen codegen(files[0], run ? "" : files[1]);
     codegen.setParser(&parser);
+    codegen.setReuseValues(share);
+    if (runtime) codegen.setRuntime(runtime);
+    codegen.setOptLevel(opt_level);
+    if (passes) codegen.setPasses(passes);
+    codegen.setDumpIR(dump_ir);
     codegen.gen();
-    codegen.print();
+    if (opt_report) codegen.optReport();
+    if (run) return codegen.run();
+    codegen.emit();
 }
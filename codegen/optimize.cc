@@ -0,0 +1,121 @@
+#include "codegen/codegen.hh"
+
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <chrono>
+#include <iomanip>
+
+namespace Frontend
+{
+void Codegen::optimize(Module &mod, TargetMachine &machine, unsigned level,
+                       const std::string &pipeline)
+{
+    // Analyses see the host through the machine, so cost models (inlining,
+    // unrolling, vectorizing) match what the backend will do
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PassBuilder builder(&machine);
+    builder.registerModuleAnalyses(MAM);
+    builder.registerCGSCCAnalyses(CGAM);
+    builder.registerFunctionAnalyses(FAM);
+    builder.registerLoopAnalyses(LAM);
+    builder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    static const OptimizationLevel levels[] =
+    {
+        OptimizationLevel::O0, OptimizationLevel::O1,
+        OptimizationLevel::O2, OptimizationLevel::O3
+    };
+
+    ModulePassManager passes;
+    if (!pipeline.empty())
+    {
+        if (auto err = builder.parsePassPipeline(passes, pipeline))
+        {
+            std::cerr << "[Error] passes \"" << pipeline << "\": "
+                      << toString(std::move(err)) << "\n";
+            exit(0);
+        }
+    }
+    else if (level == 0)
+        passes = builder.buildO0DefaultPipeline(levels[level]);
+    else
+        passes = builder.buildPerModuleDefaultPipeline(levels[level]);
+
+    passes.run(mod, MAM);
+}
+
+// Bytes of code in an object file, its text sections
+static uint64_t textBytes(SmallVectorImpl<char> &obj_buf)
+{
+    auto obj = object::ObjectFile::createObjectFile(
+        MemoryBufferRef(StringRef(obj_buf.data(), obj_buf.size()), "report"));
+    if (!obj)
+    {
+        consumeError(obj.takeError());
+        return 0;
+    }
+
+    uint64_t bytes = 0;
+    for (auto &section : (*obj)->sections())
+    {
+        if (section.isText()) bytes += section.getSize();
+    }
+    return bytes;
+}
+
+void Codegen::optReport()
+{
+    // -O0..-O3, then the custom pipeline if there is one; each compiles a
+    // copy of the module
+    unsigned num_rows = pass_pipeline.empty() ? 4 : 5;
+
+    std::cerr << std::setw(8) << "level" << std::setw(10) << "opt ms"
+              << std::setw(10) << "emit ms" << std::setw(10) << "total ms"
+              << std::setw(12) << "code bytes" << std::setw(12) << "IR instrs"
+              << "\n";
+
+    for (unsigned row = 0; row < num_rows; row++)
+    {
+        // The custom row uses the chosen level for the backend
+        bool is_custom = row == 4;
+        unsigned level = is_custom ? opt_level : row;
+
+        auto copy = CloneModule(*module);
+        auto machine = hostMachine(level);
+        copy->setTargetTriple(machine->getTargetTriple().str());
+        copy->setDataLayout(machine->createDataLayout());
+
+        auto start = std::chrono::steady_clock::now();
+        optimize(*copy, *machine, level, is_custom ? pass_pipeline : "");
+        auto optimized = std::chrono::steady_clock::now();
+
+        // Counted before emitting, the backend rewrites the IR too
+        // (CodeGenPrepare and the like)
+        size_t num_instrs = 0;
+        for (auto &func : *copy)
+            num_instrs += func.getInstructionCount();
+
+        auto emit_start = std::chrono::steady_clock::now();
+        SmallVector<char, 0> obj_buf;
+        raw_svector_ostream out(obj_buf);
+        emitNative(*copy, *machine, out, false);
+        auto emitted = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::milli> opt_ms = optimized - start;
+        std::chrono::duration<double, std::milli> emit_ms = emitted - emit_start;
+        std::string name = is_custom ? "custom" : "-O" + std::to_string(level);
+        std::cerr << std::setw(8) << name
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << opt_ms.count()
+                  << std::setw(10) << emit_ms.count()
+                  << std::setw(10) << (opt_ms + emit_ms).count()
+                  << std::setw(12) << textBytes(obj_buf)
+                  << std::setw(12) << num_instrs << "\n";
+    }
+}
+}
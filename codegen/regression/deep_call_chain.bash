@@ -0,0 +1,37 @@
+# Slow regression test for --run, kept out of test_apps: about a minute
+# at the default depth. Builds a chain f0 -> f1 -> ... of DEPTH functions,
+# each called for the first time from inside the one before it, and runs
+# it under the JIT. When the JIT compiled each function on top of the
+# calls in progress, an 8 MB stack overflowed (segfault, rc 139) from a
+# depth of about 2100 on. Run from codegen/ after building it.
+
+DEPTH=${1:-2200}
+ulimit -s 8192
+SRC=$(mktemp --suffix=.txt)
+
+for ((i = DEPTH - 1; i >= 0; i--)); do
+  echo "int f$i(int x)"
+  echo "{"
+  if ((i == DEPTH - 1)); then
+    echo "    return x + 1;"
+  else
+    echo "    return f$((i + 1))(x + 1);"
+  fi
+  echo "}"
+  echo ""
+done > $SRC
+echo "int main()" >> $SRC
+echo "{" >> $SRC
+echo "    printVarInt(f0(0));" >> $SRC
+echo "    return 0;" >> $SRC
+echo "}" >> $SRC
+
+OUT=$(./codegen --run $SRC 2>&1)
+RC=$?
+rm $SRC
+
+if [ $RC -ne 0 ] || [ "$OUT" != "$DEPTH" ]; then
+  echo "FAIL deep_call_chain $DEPTH: rc $RC, output $OUT"
+  exit 1
+fi
+echo "PASS deep_call_chain $DEPTH"
@@ -0,0 +1,763 @@
+#include "interp/interp.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace Frontend
+{
+Interp::Interp(Parser &_parser) : parser(_parser)
+{
+    for (auto statement : parser.getProgram().getStatements())
+    {
+        assert(statement->isStatementFunc());
+        auto func = statement->as<FuncStatement>();
+        func_ids[func->getFuncSymbol()] = funcs.size();
+        funcs.push_back({func});
+    }
+}
+
+int32_t Interp::runMain()
+{
+    for (uint32_t id = 0; id < funcs.size(); id++)
+    {
+        if (funcs[id].func->getFuncName() == "main")
+        {
+            enter(id, stack_top);
+            return run().i;
+        }
+    }
+    std::cerr << "[Error] no main function to run\n";
+    exit(0);
+}
+
+/* Quickening */
+
+// Blocks are laid out off a stack of (statement, where its id goes in
+// lists), in source order, so a declaration is always quickened before
+// its uses
+void Interp::quicken(Function &func)
+{
+    auto &slots = func.func->getSlots();
+    func.num_args = func.func->getFuncArgs().size();
+    func.frame_size = slots.size();
+
+    std::vector<Range> arrays(slots.size());
+    std::vector<std::pair<Statement*,uint32_t>> pending;
+
+    quickenBlock(func, func.func->getFuncCodes(), pending);
+    while (!pending.empty())
+    {
+        auto [statement, at] = pending.back();
+        pending.pop_back();
+
+        Stmt stmt{Kind::EVAL};
+        auto id = statement->visit(Overloaded{
+            [&](AssnStatement &assn) { return quickenAssn(func, &assn, arrays); },
+            [&](CallStatement &call)
+            {
+                if (call.isBuiltIn())
+                {
+                    auto call_expr = call.getCallExpr();
+                    assert(call_expr->getArgs().size() == 1);
+                    stmt.kind = (call_expr->getCallFunc() == "printVarInt") ?
+                                Kind::PRINT_INT : Kind::PRINT_FLOAT;
+                    stmt.expr = flatten(func, call_expr->getArgs()[0], arrays);
+                }
+                else
+                {
+                    stmt.expr = flatten(func, call.getExpr(), arrays);
+                }
+                func.stmts.push_back(stmt);
+                return (uint32_t)func.stmts.size() - 1;
+            },
+            [&](RetStatement &ret)
+            {
+                stmt.kind = Kind::RET;
+                stmt.has_value = (ret.getRetVal() != nullptr);
+                if (stmt.has_value)
+                    stmt.expr = flatten(func, ret.getRetVal(), arrays);
+                func.stmts.push_back(stmt);
+                return (uint32_t)func.stmts.size() - 1;
+            },
+            [&](IfStatement &if_s)
+            {
+                stmt.kind = Kind::IF;
+                stmt.cond = quickenCond(func, if_s.getCond(), arrays);
+                stmt.body = quickenBlock(func, if_s.getTakenBlock(), pending);
+                if (!if_s.getNotTakenBlock().empty())
+                {
+                    stmt.orelse = quickenBlock(func, if_s.getNotTakenBlock(),
+                                               pending);
+                }
+                func.stmts.push_back(stmt);
+                return (uint32_t)func.stmts.size() - 1;
+            },
+            [&](ForStatement &for_s)
+            {
+                stmt.kind = Kind::FOR;
+                stmt.init = quickenAssn(func, for_s.getStart()->as<AssnStatement>(),
+                                        arrays);
+                stmt.cond = quickenCond(func, for_s.getEnd(), arrays);
+                stmt.step = quickenAssn(func, for_s.getStep()->as<AssnStatement>(),
+                                        arrays);
+                stmt.body = quickenBlock(func, for_s.getBlock(), pending);
+                func.stmts.push_back(stmt);
+                return (uint32_t)func.stmts.size() - 1;
+            },
+            [&](WhileStatement &while_s)
+            {
+                stmt.kind = Kind::WHILE;
+                stmt.cond = quickenCond(func, while_s.getEnd(), arrays);
+                stmt.body = quickenBlock(func, while_s.getBlock(), pending);
+                func.stmts.push_back(stmt);
+                return (uint32_t)func.stmts.size() - 1;
+            },
+            [&](FuncStatement&) -> uint32_t
+            {
+                assert(false && "[Error] quicken: nested function. \n");
+                return NO_STMT;
+            }
+        });
+        func.lists[at] = id;
+    }
+    func.quickened = true;
+}
+
+// The block gets its place in lists now, its statements are filled in as
+// pending reaches them
+uint32_t Interp::quickenBlock(Function &func, ArenaSpan<Statement*> &block,
+                              std::vector<std::pair<Statement*,uint32_t>> &pending)
+{
+    Stmt stmt{Kind::BLOCK};
+    stmt.range.begin = func.lists.size();
+    stmt.range.end = stmt.range.begin + block.size();
+    func.lists.resize(stmt.range.end);
+
+    for (auto i = block.size(); i-- > 0; )
+        pending.push_back({block[i], stmt.range.begin + (uint32_t)i});
+
+    func.stmts.push_back(stmt);
+    return func.stmts.size() - 1;
+}
+
+uint32_t Interp::quickenAssn(Function &func, AssnStatement *assn,
+                             std::vector<Range> &arrays)
+{
+    auto iden = assn->getIden();
+    auto expr = assn->getExpr();
+
+    Stmt stmt{Kind::STORE};
+    if (auto index = iden->as<IndexExpression>())
+    {
+        auto &array = arrays[index->getSlot()];
+        stmt.kind = Kind::STORE_INDEX;
+        stmt.slot = array.begin;
+        stmt.length = array.end - array.begin;
+        stmt.index = flatten(func, index->getIndex(), arrays);
+    }
+    else
+    {
+        auto lit = iden->as<LiteralExpression>();
+        assert(lit != nullptr);
+        stmt.slot = lit->getSlot();
+    }
+
+    auto array_info = (expr != nullptr) ? expr->as<ArrayExpression>() : nullptr;
+    if (array_info != nullptr)
+    {
+        // Every array has a fixed place in the frame, like an alloca
+        auto num_ele = array_info->getNumElements()->as<LiteralExpression>();
+        assert(num_ele != nullptr && num_ele->isLiteralInt());
+
+        auto &elements = array_info->getElements();
+        uint32_t length = num_ele->getInt();
+        if (elements.size() > length)
+        {
+            std::cerr << "[Error] " << elements.size() << " initializers for "
+                      << length << " array elements\n";
+            exit(0);
+        }
+
+        auto &array = arrays[stmt.slot];
+        array.begin = func.frame_size;
+        array.end = func.frame_size + length;
+        func.frame_size = array.end;
+
+        stmt.kind = Kind::ARRAY;
+        stmt.slot = array.begin;
+        stmt.length = length;
+        stmt.range.begin = func.codes.size();
+        for (auto ele : elements)
+            func.codes.push_back(flatten(func, ele, arrays));
+        stmt.range.end = func.codes.size();
+    }
+    else if (expr != nullptr)
+    {
+        stmt.expr = flatten(func, expr, arrays);
+    }
+    else
+    {
+        // Declared without a value, starts at 0
+        stmt.expr = {(uint32_t)func.nodes.size(),
+                     (uint32_t)func.nodes.size() + 1, 1};
+        func.nodes.push_back({Op::CONST, 0, {0}});
+    }
+
+    func.stmts.push_back(stmt);
+    return func.stmts.size() - 1;
+}
+
+Interp::Cond Interp::quickenCond(Function &func, Condition *cond,
+                                 std::vector<Range> &arrays)
+{
+    static const std::pair<std::string_view, Cmp> cmps[] =
+    {
+        {"==", Cmp::EQ_I}, {"!=", Cmp::NE_I}, {">", Cmp::GT_I},
+        {">=", Cmp::GE_I}, {"<", Cmp::LT_I}, {"<=", Cmp::LE_I}
+    };
+
+    Cond quick;
+    auto opr = cond->getOpr();
+    for (auto [text, cmp] : cmps)
+    {
+        if (opr == text) quick.cmp = cmp;
+    }
+    if (cond->getType() == ValueType::Type::FLOAT)
+        quick.cmp = (Cmp)((int)quick.cmp + (int)Cmp::EQ_F);
+
+    quick.left = flatten(func, cond->getLeft(), arrays);
+    quick.right = flatten(func, cond->getRight(), arrays);
+    return quick;
+}
+
+// Post-order off a stack of (expression, operands done). A number literal
+// operand of an arithmetic node does not get a node of its own, it is
+// folded into the operator (the *_K ops) - on the right, or on the left
+// of + and *. Operands go on the stack in the order codegen evaluates
+// them; a right-first pair is swapped back before - and /.
+Interp::Code Interp::flatten(Function &func, Expression *root,
+                             std::vector<Range> &arrays)
+{
+    auto &nodes = func.nodes;
+    Code code;
+    code.begin = nodes.size();
+
+    uint32_t depth = 0;
+    auto emit = [&](Op op, uint32_t arg, Value imm, int pushed)
+    {
+        nodes.push_back({op, arg, imm});
+        depth += pushed;
+        code.depth = std::max(code.depth, depth);
+    };
+
+    auto number = [](Expression *expr) -> LiteralExpression*
+    {
+        auto lit = expr->as<LiteralExpression>();
+        return (lit != nullptr && !lit->isVariable()) ? lit : nullptr;
+    };
+    auto immediate = [](LiteralExpression *lit)
+    {
+        Value val;
+        if (lit->isLiteralInt())
+            val.i = lit->getInt();
+        else
+            val.f = lit->getFloat();
+        return val;
+    };
+
+    std::vector<std::pair<Expression*,bool>> pending{{root, false}};
+    while (!pending.empty())
+    {
+        auto [expr, operands_done] = pending.back();
+        pending.pop_back();
+
+        auto push = [&](Expression *operand)
+                    { pending.push_back({operand, false}); };
+        if (!operands_done)
+        {
+            if (auto lit = expr->as<LiteralExpression>())
+            {
+                if (lit->isVariable())
+                    emit(Op::LOAD, lit->getSlot(), {0}, 1);
+                else
+                    emit(Op::CONST, 0, immediate(lit), 1);
+                continue;
+            }
+
+            pending.push_back({expr, true});
+            expr->visit(Overloaded{
+                [&](LiteralExpression&) {},
+                [&](ArithExpression &arith)
+                {
+                    auto opr = arith.getType();
+                    bool commutes = (opr == ExpressionType::PLUS ||
+                                     opr == ExpressionType::ASTERISK);
+                    if (number(arith.getRight()))
+                        push(arith.getLeft());
+                    else if (commutes && number(arith.getLeft()))
+                        push(arith.getRight());
+                    else if (rightFirst(&arith))
+                    {
+                        push(arith.getLeft());
+                        push(arith.getRight());
+                    }
+                    else
+                    {
+                        push(arith.getRight());
+                        push(arith.getLeft());
+                    }
+                },
+                [&](IndexExpression &index) { push(index.getIndex()); },
+                [&](CallExpression &call)
+                {
+                    auto &args = call.getArgs();
+                    for (auto iter = args.end(); iter != args.begin(); )
+                        push(*--iter);
+                },
+                [&](ArrayExpression&)
+                {
+                    assert(false && "[Error] flatten: array outside a declaration. \n");
+                }
+            });
+            continue;
+        }
+
+        expr->visit(Overloaded{
+            [&](LiteralExpression&) {},
+            [&](ArithExpression &arith)
+            {
+                auto opr = arith.getType();
+                int idx = (int)opr - (int)ExpressionType::PLUS;
+                if (expr->getValueType() == ValueType::Type::FLOAT) idx += 4;
+
+                bool commutes = (opr == ExpressionType::PLUS ||
+                                 opr == ExpressionType::ASTERISK);
+                if (auto lit = number(arith.getRight()))
+                {
+                    emit((Op)((int)Op::ADD_IK + idx), 0, immediate(lit), 0);
+                }
+                else if (auto lit = commutes ? number(arith.getLeft()) : nullptr)
+                {
+                    emit((Op)((int)Op::ADD_IK + idx), 0, immediate(lit), 0);
+                }
+                else
+                {
+                    if (rightFirst(&arith) && !commutes)
+                        emit(Op::SWAP, 0, {0}, 0);
+                    emit((Op)((int)Op::ADD_I + idx), 0, {0}, -1);
+                }
+            },
+            [&](IndexExpression &index)
+            {
+                auto &array = arrays[index.getSlot()];
+                Value length;
+                length.i = array.end - array.begin;
+                emit(Op::LOAD_INDEX, array.begin, length, 0);
+            },
+            [&](CallExpression &call)
+            {
+                auto iter = func_ids.find(call.getCallFuncSymbol());
+                if (iter == func_ids.end())
+                {
+                    std::cerr << "[Error] Please define function before CALL\n";
+                    exit(0);
+                }
+                Value num_args;
+                num_args.i = call.getArgs().size();
+                emit(Op::CALL, iter->second, num_args, 1 - num_args.i);
+            },
+            [&](ArrayExpression&) {}
+        });
+    }
+
+    code.end = nodes.size();
+    return code;
+}
+
+/* Running */
+
+void Interp::enter(uint32_t id, size_t args)
+{
+    auto &func = funcs[id];
+    if (!func.quickened) quicken(func);
+
+    if (calls.size() >= MAX_CALL_DEPTH)
+    {
+        std::cerr << "[Error] calls nested over " << MAX_CALL_DEPTH
+                  << " deep\n";
+        exit(0);
+    }
+
+    // A fresh frame is all zeros, the arguments are taken off the stack
+    auto base = memory.size();
+    memory.resize(base + func.frame_size);
+    std::copy(stack.begin() + args, stack.begin() + args + func.num_args,
+              memory.begin() + base);
+    stack_top = args;
+
+    calls.push_back({id, base, frames.size()});
+    frames.push_back({0, 0, 0, NOT_STARTED});
+}
+
+bool Interp::leave(Value ret)
+{
+    auto call = calls.back();
+    calls.pop_back();
+    frames.resize(call.frames_base);
+    memory.resize(call.base);
+
+    // The caller's expression picks up with the value on its stack
+    *growStack(1) = ret;
+    stack_top++;
+    return !calls.empty();
+}
+
+// Every frame is a statement of the innermost call. Blocks and loops push
+// their nested statements, simple statements run and pop. A statement's
+// expressions (parts) are evaluated in order onto the stack, and a call
+// partway through one just enters the callee - the caller's frame keeps
+// where it was and carries on once the value is back.
+Value Interp::run()
+{
+    while (true)
+    {
+        auto call = calls.back();
+        auto &func = funcs[call.func];
+        auto base = call.base;
+
+        if (frames.size() == call.frames_base)
+        {
+            // Fell off the end of the body
+            if (!leave(Value{0})) break;
+            continue;
+        }
+
+        uint32_t top = frames.size() - 1;
+        auto cur = frames[top];
+        auto &stmt = func.stmts[cur.stmt];
+
+        // Statements that evaluate parts first; false when it entered a call
+        auto parts = [&]()
+        {
+            if (evalParts(func, frames[top], base)) return true;
+            enter(pending_call.first, pending_call.second);
+            return false;
+        };
+        auto pop = [&](size_t num) { stack_top -= num; };
+        auto value = [&](size_t idx) { return stack[stack_top - idx - 1]; };
+        auto frame = [](uint32_t id) { return Frame{id, 0, 0, NOT_STARTED}; };
+
+        // A nested statement. A simple one runs right here, true when it
+        // is done; if it stops at a call, or is anything else, it gets a
+        // frame.
+        auto nested = [&](uint32_t id)
+        {
+            auto &child = func.stmts[id];
+            if (child.kind != Kind::BLOCK && child.kind < Kind::RET)
+            {
+                auto child_frame = frame(id);
+                if (evalParts(func, child_frame, base))
+                {
+                    finish(func, child, base);
+                    return true;
+                }
+                frames.push_back(child_frame);
+                enter(pending_call.first, pending_call.second);
+                return false;
+            }
+            frames.push_back(frame(id));
+            return false;
+        };
+
+        switch (stmt.kind)
+        {
+            case Kind::BLOCK:
+            {
+                // Simple statements one after another without a frame
+                auto step = cur.step;
+                while (stmt.range.begin + step != stmt.range.end)
+                {
+                    frames[top].step = ++step;
+                    if (!nested(func.lists[stmt.range.begin + step - 1]))
+                        break;
+                }
+                if (stmt.range.begin + step == stmt.range.end &&
+                    frames.size() == top + 1u)
+                    frames.pop_back();
+                break;
+            }
+            case Kind::IF:
+            {
+                if (!parts()) break;
+                bool taken = compare(stmt.cond.cmp, value(1), value(0));
+                pop(2);
+
+                auto arm = taken ? stmt.body : stmt.orelse;
+                if (arm == NO_STMT)
+                    frames.pop_back();
+                else
+                    frames[top] = frame(arm);
+                break;
+            }
+            case Kind::WHILE:
+            {
+                if (!parts()) break;
+                bool taken = compare(stmt.cond.cmp, value(1), value(0));
+                pop(2);
+
+                if (taken)
+                {
+                    frames[top].part = 0;
+                    frames.push_back(frame(stmt.body));
+                }
+                else
+                    frames.pop_back();
+                break;
+            }
+            case Kind::FOR:
+            {
+                // step - 0: init to run; 1: test to run; 2: body done,
+                // step to run
+                if (cur.step != 1)
+                {
+                    frames[top].step = 1;
+                    nested(cur.step == 0 ? stmt.init : stmt.step);
+                    break;
+                }
+
+                if (!parts()) break;
+                bool taken = compare(stmt.cond.cmp, value(1), value(0));
+                pop(2);
+
+                if (taken)
+                {
+                    frames[top].step = 2;
+                    frames[top].part = 0;
+                    frames.push_back(frame(stmt.body));
+                }
+                else
+                    frames.pop_back();
+                break;
+            }
+            case Kind::RET:
+            {
+                if (!parts()) break;
+                Value ret{0};
+                if (stmt.has_value)
+                {
+                    ret = value(0);
+                    pop(1);
+                }
+                if (!leave(ret)) return stack[stack_top - 1];
+                break;
+            }
+            default:
+                if (!parts()) break;
+                finish(func, stmt, base);
+                frames.pop_back();
+                break;
+        }
+    }
+    return stack[stack_top - 1];
+}
+
+void Interp::finish(Function &func, const Stmt &stmt, size_t base)
+{
+    auto pop = [&](size_t num) { stack_top -= num; };
+    auto value = [&](size_t idx) { return stack[stack_top - idx - 1]; };
+
+    switch (stmt.kind)
+    {
+        case Kind::STORE:
+            memory[base + stmt.slot] = value(0);
+            pop(1);
+            break;
+        case Kind::STORE_INDEX:
+            // the index is checked as soon as it is known, see evalParts
+            memory[base + stmt.slot + value(1).i] = value(0);
+            pop(2);
+            break;
+        case Kind::ARRAY:
+        {
+            auto length = stmt.range.end - stmt.range.begin;
+            std::copy(stack.begin() + stack_top - length,
+                      stack.begin() + stack_top,
+                      memory.begin() + base + stmt.slot);
+            pop(length);
+            break;
+        }
+        // As util/print.c
+        case Kind::PRINT_INT:
+            printf("%d\n", value(0).i);
+            pop(1);
+            break;
+        case Kind::PRINT_FLOAT:
+            printf("%f\n", value(0).f);
+            pop(1);
+            break;
+        case Kind::EVAL:
+            pop(1);
+            break;
+        default:
+            assert(false && "[Error] finish: not a simple statement. \n");
+    }
+}
+
+uint32_t Interp::numParts(const Stmt &stmt)
+{
+    switch (stmt.kind)
+    {
+        case Kind::BLOCK: return 0;
+        case Kind::ARRAY: return stmt.range.end - stmt.range.begin;
+        case Kind::STORE_INDEX: return 2;
+        case Kind::IF:
+        case Kind::WHILE:
+        case Kind::FOR: return 2;
+        case Kind::RET: return stmt.has_value ? 1 : 0;
+        default: return 1;
+    }
+}
+
+const Interp::Code& Interp::partCode(Function &func, const Stmt &stmt,
+                                     uint32_t part)
+{
+    switch (stmt.kind)
+    {
+        case Kind::ARRAY: return func.codes[stmt.range.begin + part];
+        case Kind::STORE_INDEX: return part == 0 ? stmt.index : stmt.expr;
+        case Kind::IF:
+        case Kind::WHILE:
+        case Kind::FOR: return part == 0 ? stmt.cond.left : stmt.cond.right;
+        default: return stmt.expr;
+    }
+}
+
+bool Interp::evalParts(Function &func, Frame &frame, size_t base)
+{
+    auto &stmt = func.stmts[frame.stmt];
+    auto num = numParts(stmt);
+    for (auto part = frame.part; part < num; part++)
+    {
+        auto &code = partCode(func, stmt, part);
+        auto pc = frame.pc == NOT_STARTED ? code.begin : frame.pc;
+        if (!eval(func, code, pc, base))
+        {
+            frame.part = part;
+            frame.pc = pc;
+            return false;
+        }
+        frame.pc = NOT_STARTED;
+
+        // An index is checked before the value to store is evaluated
+        if (stmt.kind == Kind::STORE_INDEX && part == 0)
+        {
+            auto idx = stack[stack_top - 1].i;
+            if ((uint32_t)idx >= stmt.length)
+            {
+                std::cerr << "[Error] index " << idx << " out of bounds of "
+                          << stmt.length << " array elements\n";
+                exit(0);
+            }
+        }
+    }
+    frame.part = num;
+    return true;
+}
+
+// One pass over the nodes from pc. Ints wrap like the i32 ops codegen
+// emits; what would trap compiled is an error here.
+bool Interp::eval(Function &func, const Code &code, uint32_t &pc, size_t base)
+{
+    Value *sp = growStack(code.depth);
+    Value *frame = memory.data() + base;
+
+    auto wrap = [](uint32_t val) { return (int32_t)val; };
+    auto divide = [](int32_t lhs, int32_t rhs)
+    {
+        if (rhs == 0 || (lhs == INT_MIN && rhs == -1))
+        {
+            std::cerr << "[Error] integer division " << lhs << " / " << rhs
+                      << " traps\n";
+            exit(0);
+        }
+        return lhs / rhs;
+    };
+
+    for (auto node = &func.nodes[pc], end = &func.nodes[code.end];
+         node != end; node++)
+    {
+        switch (node->op)
+        {
+            case Op::CONST: *sp++ = node->imm; break;
+            case Op::LOAD: *sp++ = frame[node->arg]; break;
+            case Op::LOAD_INDEX:
+            {
+                auto idx = sp[-1].i;
+                if ((uint32_t)idx >= (uint32_t)node->imm.i)
+                {
+                    std::cerr << "[Error] index " << idx << " out of bounds of "
+                              << node->imm.i << " array elements\n";
+                    exit(0);
+                }
+                sp[-1] = frame[node->arg + idx];
+                break;
+            }
+            case Op::SWAP: std::swap(sp[-1], sp[-2]); break;
+
+            case Op::ADD_I: sp--; sp[-1].i = wrap((uint32_t)sp[-1].i + sp[0].i); break;
+            case Op::SUB_I: sp--; sp[-1].i = wrap((uint32_t)sp[-1].i - sp[0].i); break;
+            case Op::MUL_I: sp--; sp[-1].i = wrap((uint32_t)sp[-1].i * sp[0].i); break;
+            case Op::DIV_I: sp--; sp[-1].i = divide(sp[-1].i, sp[0].i); break;
+            case Op::ADD_F: sp--; sp[-1].f = sp[-1].f + sp[0].f; break;
+            case Op::SUB_F: sp--; sp[-1].f = sp[-1].f - sp[0].f; break;
+            case Op::MUL_F: sp--; sp[-1].f = sp[-1].f * sp[0].f; break;
+            case Op::DIV_F: sp--; sp[-1].f = sp[-1].f / sp[0].f; break;
+
+            case Op::ADD_IK: sp[-1].i = wrap((uint32_t)sp[-1].i + node->imm.i); break;
+            case Op::SUB_IK: sp[-1].i = wrap((uint32_t)sp[-1].i - node->imm.i); break;
+            case Op::MUL_IK: sp[-1].i = wrap((uint32_t)sp[-1].i * node->imm.i); break;
+            case Op::DIV_IK: sp[-1].i = divide(sp[-1].i, node->imm.i); break;
+            case Op::ADD_FK: sp[-1].f = sp[-1].f + node->imm.f; break;
+            case Op::SUB_FK: sp[-1].f = sp[-1].f - node->imm.f; break;
+            case Op::MUL_FK: sp[-1].f = sp[-1].f * node->imm.f; break;
+            case Op::DIV_FK: sp[-1].f = sp[-1].f / node->imm.f; break;
+
+            case Op::CALL:
+            {
+                // Stop here with the arguments on top of the stack, the
+                // callee's value is pushed in their place when it returns
+                sp -= node->imm.i;
+                pending_call = {node->arg, (size_t)(sp - stack.data())};
+                stack_top = pending_call.second + node->imm.i;
+                pc = node - func.nodes.data() + 1;
+                return false;
+            }
+        }
+    }
+
+    stack_top = sp - stack.data();
+    return true;
+}
+
+bool Interp::compare(Cmp cmp, Value lhs, Value rhs)
+{
+    // Float compares are ordered, false if either side is NaN
+    switch (cmp)
+    {
+        case Cmp::EQ_I: return lhs.i == rhs.i;
+        case Cmp::NE_I: return lhs.i != rhs.i;
+        case Cmp::GT_I: return lhs.i > rhs.i;
+        case Cmp::GE_I: return lhs.i >= rhs.i;
+        case Cmp::LT_I: return lhs.i < rhs.i;
+        case Cmp::LE_I: return lhs.i <= rhs.i;
+        case Cmp::EQ_F: return lhs.f == rhs.f;
+        case Cmp::NE_F: return lhs.f < rhs.f || lhs.f > rhs.f;
+        case Cmp::GT_F: return lhs.f > rhs.f;
+        case Cmp::GE_F: return lhs.f >= rhs.f;
+        case Cmp::LT_F: return lhs.f < rhs.f;
+        case Cmp::LE_F: return lhs.f <= rhs.f;
+    }
+    return false;
+}
+}
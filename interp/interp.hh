@@ -0,0 +1,243 @@
+#ifndef __INTERP_HH__
+#define __INTERP_HH__
+
+#include "parser/parser.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Frontend
+{
+/*
+ * Tree-walking interpreter, runs a parsed (folded) and resolved
+ * (parser/sema.hh) program in process - no LLVM, no linking, main starts
+ * running as soon as parsing is done.
+ *
+ * A function is quickened on its first call. Its statements are copied
+ * into a small tree of their own that names variables by frame offset,
+ * and each expression is laid out flat, operands before operators, so
+ * walking it is one pass. Literals become immediates of the node that
+ * uses them, every operator is typed up front; nothing is looked up or
+ * converted while running.
+ *
+ * Nesting costs no native stack: statements are walked off a frame
+ * stack, and a call in the program stops the expression it is in and
+ * pushes the callee's frames on top. Calls nest up to MAX_CALL_DEPTH deep;
+ * past that the program is taken to be running away and stops with an
+ * [Error] rather than exhausting memory.
+ *
+ * printVarInt/printVarFloat print the way util/print.c does.
+ * */
+
+// An int or a float, what every variable and array element holds
+union Value
+{
+    int32_t i;
+    float f;
+};
+
+class Interp
+{
+  protected:
+    // Expression nodes. *_K take their right operand as an immediate.
+    enum class Op : uint8_t
+    {
+        CONST,      // imm
+        LOAD,       // frame[arg]
+        LOAD_INDEX, // frame[arg + index], imm.i elements
+        SWAP,       // operands came right first, see flatten
+
+        ADD_I, SUB_I, MUL_I, DIV_I,
+        ADD_F, SUB_F, MUL_F, DIV_F,
+        ADD_IK, SUB_IK, MUL_IK, DIV_IK,
+        ADD_FK, SUB_FK, MUL_FK, DIV_FK,
+
+        CALL        // function arg, imm.i arguments
+    };
+
+    struct Node
+    {
+        Op op;
+        uint32_t arg;
+        Value imm;
+    };
+
+    // An expression, nodes [begin, end) of its function; depth is the
+    // most values it has on the stack at once
+    struct Code
+    {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        uint32_t depth = 0;
+    };
+
+    enum class Cmp : uint8_t
+    {
+        EQ_I, NE_I, GT_I, GE_I, LT_I, LE_I,
+        EQ_F, NE_F, GT_F, GE_F, LT_F, LE_F
+    };
+
+    struct Cond
+    {
+        Cmp cmp;
+        Code left;
+        Code right;
+    };
+
+    // A range of Function::lists (statement ids) or Function::codes
+    struct Range
+    {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    enum class Kind : uint8_t
+    {
+        BLOCK,       // range
+        STORE,       // frame[slot] = expr
+        STORE_INDEX, // frame[slot + index] = expr, length elements
+        ARRAY,       // frame[slot...] = elements, length of them
+        PRINT_INT,
+        PRINT_FLOAT,
+        EVAL,        // a call, the value is dropped
+        RET,         // expr, if has_value
+        IF,          // cond, then arm or else arm
+        WHILE,       // cond, body
+        FOR          // init, cond, body, step
+    };
+
+    struct Stmt
+    {
+        Kind kind;
+        bool has_value = false;
+        uint32_t slot = 0;
+        uint32_t length = 0;
+        Code expr;
+        Code index;
+        // BLOCK: its statements in lists; ARRAY: its elements in codes
+        Range range;
+        Cond cond;
+        // statement ids - IF: the arms (NO_STMT for no else); loops: the
+        // body, and the init and step of a for
+        uint32_t body = NO_STMT;
+        uint32_t orelse = NO_STMT;
+        uint32_t init = NO_STMT;
+        uint32_t step = NO_STMT;
+    };
+    static constexpr uint32_t NO_STMT = UINT32_MAX;
+
+    struct Function
+    {
+        FuncStatement *func;
+        bool quickened = false;
+        uint32_t num_args = 0;
+
+        // scalars by slot, then every array of the function
+        uint32_t frame_size = 0;
+
+        // statement 0 is the body
+        std::vector<Stmt> stmts;
+        std::vector<uint32_t> lists;
+        std::vector<Node> nodes;
+        std::vector<Code> codes;
+    };
+
+    Parser &parser;
+
+    std::vector<Function> funcs;
+    std::unordered_map<Symbol, uint32_t> func_ids;
+
+    // Frames of every call in progress, innermost last, and the values
+    // of the expressions being evaluated, stack_top of them
+    std::vector<Value> memory;
+    std::vector<Value> stack;
+    size_t stack_top = 0;
+
+    // Room for num more values on the stack, the first of them
+    Value* growStack(size_t num)
+    {
+        if (stack.size() < stack_top + num)
+            stack.resize(std::max(stack.size() * 2, stack_top + num));
+        return stack.data() + stack_top;
+    }
+
+    // A call in progress - its function, its frame in memory, and where
+    // its statements start in frames
+    struct Call
+    {
+        uint32_t func;
+        size_t base;
+        size_t frames_base;
+    };
+    std::vector<Call> calls;
+    static constexpr size_t MAX_CALL_DEPTH = 2000000;
+
+    // A statement partway through running - BLOCK: statements done; FOR:
+    // see run. part is the expression being evaluated (see evalParts)
+    // and pc its next node, NOT_STARTED before its first. An IF is
+    // replaced by its arm.
+    struct Frame
+    {
+        uint32_t stmt;
+        uint32_t step;
+        uint32_t part;
+        uint32_t pc;
+    };
+    static constexpr uint32_t NOT_STARTED = UINT32_MAX;
+    std::vector<Frame> frames;
+
+    // The call eval stopped at - function, where its arguments start on
+    // the stack
+    std::pair<uint32_t,size_t> pending_call;
+
+    // Quickening, see the comment above. arrays has the frame offsets
+    // of each array slot's elements.
+    void quicken(Function &func);
+    uint32_t quickenBlock(Function &func, ArenaSpan<Statement*> &block,
+                          std::vector<std::pair<Statement*,uint32_t>> &pending);
+    uint32_t quickenAssn(Function &func, AssnStatement *assn,
+                         std::vector<Range> &arrays);
+    Cond quickenCond(Function &func, Condition *cond,
+                     std::vector<Range> &arrays);
+    Code flatten(Function &func, Expression *root,
+                 std::vector<Range> &arrays);
+
+    // Running. enter/leave push and pop a call, leave is false once
+    // the outermost returned.
+    void enter(uint32_t id, size_t args);
+    bool leave(Value ret);
+    Value run();
+    // The expressions a statement evaluates, in order
+    static uint32_t numParts(const Stmt &stmt);
+    static const Code& partCode(Function &func, const Stmt &stmt,
+                                uint32_t part);
+    // Evaluate the rest of a frame's parts onto the stack; false when one
+    // stopped at a call. It pushes no frames, frame may be one of them.
+    bool evalParts(Function &func, Frame &frame, size_t base);
+    // Run a simple statement (not RET) on its evaluated parts
+    void finish(Function &func, const Stmt &stmt, size_t base);
+    // Leaves its value on the stack; false when it stopped at a call,
+    // see pending_call, and pc is where to pick up
+    bool eval(Function &func, const Code &code, uint32_t &pc, size_t base);
+    static bool compare(Cmp cmp, Value lhs, Value rhs);
+
+    // The operands of a right-first arithmetic node go on the stack in
+    // that order, see flatten
+    static bool rightFirst(ArithExpression *arith)
+    {
+        return !arith->getLeft()->isExprArith() &&
+               arith->getRight()->isExprArith();
+    }
+
+  public:
+    Interp(Parser &_parser);
+
+    // Run main, its return value
+    int32_t runMain();
+};
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "parser/parser.hh"
+#include "parser/fold.hh"
+#include "parser/sema.hh"
+#include "interp/interp.hh"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace Frontend;
+
+int main(int argc, char* argv[])
+{
+    // interp [--cache DIR] [--no-fold] <source>
+    //   --cache DIR - take the AST from the cache in DIR, parse and save
+    //                 it there on a miss
+    //   --no-fold   - run every operation as written, no constant folding
+    // Exits with what main returns, like the compiled program.
+    const char* cache_dir = nullptr;
+    bool fold = true;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--no-fold") == 0)
+            fold = false;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != 1)
+    {
+        std::cerr << "[Error] usage: interp [--cache DIR] [--no-fold] <source>\n";
+        exit(0);
+    }
+
+    // Parser
+    Parser parser(files[0], false, 1, cache_dir);
+
+    // AST passes
+    if (fold) ASTFolder(parser.getProgram()).foldProgram();
+    Sema(parser).run();
+
+    // Run
+    Interp interp(parser);
+    return interp.runMain();
+}
@@ -0,0 +1,219 @@
+#include "lexer/lexer.hh"
+#include "lexer/pipe.hh"
+#include "lexer/simd.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace Frontend;
+
+// Lex the whole file once, return the number of tokens
+static size_t lexOnce(const char* fn, Lexer::Mode mode, Lexer::Scanner scanner)
+{
+    Lexer lexer(fn, mode, scanner);
+
+    Token tok;
+    size_t num_toks = 0;
+    while (lexer.getToken(tok)) num_toks++;
+    return num_toks;
+}
+
+// Lex the whole file into one TokenBuffer, return the number of tokens
+static size_t batchOnce(const char* fn, Lexer::Mode mode, Lexer::Scanner scanner,
+                        unsigned num_threads)
+{
+    Lexer lexer(fn, mode, scanner);
+
+    TokenBuffer toks;
+    lexer.tokenize(toks, num_threads);
+    return toks.size();
+}
+
+// Lex on a separate thread, pop the tokens through a TokenPipe
+static size_t pipeOnce(const char* fn, Lexer::Scanner scanner)
+{
+    Lexer lexer(fn, Lexer::Mode::MMAP, scanner);
+
+    TokenPipe pipe;
+    pipe.start(lexer);
+
+    size_t num_toks = 0;
+    while (!pipe.pop().isTokenEOF()) num_toks++;
+    return num_toks;
+}
+
+// Parallel lexing must hand out exactly the tokens and symbols of a serial run
+static bool sameAsSerial(const char* fn, Lexer::Scanner scanner,
+                         unsigned num_threads)
+{
+    Lexer serial(fn, Lexer::Mode::MMAP, scanner);
+    Lexer parallel(fn, Lexer::Mode::MMAP, scanner);
+
+    TokenBuffer serial_toks, parallel_toks;
+    serial.tokenize(serial_toks);
+    parallel.tokenize(parallel_toks, num_threads);
+
+    if (serial_toks.size() != parallel_toks.size()) return false;
+    for (size_t i = 0; i < serial_toks.size(); i++)
+    {
+        if (serial_toks.type(i) != parallel_toks.type(i) ||
+            serial_toks.offset(i) != parallel_toks.offset(i) ||
+            serial_toks.literal(i) != parallel_toks.literal(i) ||
+            serial_toks.value(i).i != parallel_toks.value(i).i)
+            return false;
+    }
+
+    auto &serial_syms = serial.getSymbols();
+    auto &parallel_syms = parallel.getSymbols();
+    if (serial_syms.size() != parallel_syms.size()) return false;
+    for (Symbol sym = 0; sym < serial_syms.size(); sym++)
+    {
+        if (serial_syms.name(sym) != parallel_syms.name(sym)) return false;
+    }
+    return true;
+}
+
+// Only the run scanning helpers - blanks, then a run, then one break
+// character - over the whole buffer, return the number of runs
+static size_t scanOnce(std::string_view buf)
+{
+    auto iter = buf.data();
+    auto end = buf.data() + buf.size();
+
+    size_t num_runs = 0;
+    while (iter != end)
+    {
+        iter = SIMD::skipBlanks(iter, end);
+        auto run_end = SIMD::findBreak(iter, end);
+        num_runs += (run_end != iter);
+        iter = (run_end != end) ? run_end + 1 : end;
+    }
+    return num_runs;
+}
+
+static void report(const char* name, size_t count, const char* unit,
+                   size_t bytes, double secs)
+{
+    std::cout << std::setw(12) << name << " | "
+              << std::setw(10) << count << " " << unit << " | "
+              << std::fixed << std::setprecision(2)
+              << std::setw(8) << secs * 1e3 << " ms | "
+              << std::setw(8) << bytes / secs / 1e6 << " MB/s\n";
+}
+
+static void run(const char* name, const char* fn, size_t bytes, int reps,
+                Lexer::Mode mode, Lexer::Scanner scanner, bool batch = false,
+                unsigned num_threads = 1, bool piped = false)
+{
+    size_t num_toks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++)
+    {
+        if (piped)
+            num_toks = pipeOnce(fn, scanner);
+        else if (batch)
+            num_toks = batchOnce(fn, mode, scanner, num_threads);
+        else
+            num_toks = lexOnce(fn, mode, scanner);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(end - start).count() / reps;
+    report(name, num_toks, "tokens", bytes, secs);
+}
+
+static void scan(const char* name, std::string_view buf, int reps)
+{
+    size_t num_runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++)
+        num_runs = scanOnce(buf);
+    auto end = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(end - start).count() / reps;
+    report(name, num_runs, "runs  ", buf.size(), secs);
+}
+int main(int argc, char* argv[])
+{
+    // bench <source> [repetitions]
+    const char* fn = argv[1];
+    int reps = (argc > 2) ? atoi(argv[2]) : 5;
+
+    SourceBuffer source(fn);
+    size_t bytes = source.length();
+
+    run("line+hash", fn, bytes, reps, Lexer::Mode::LINE, Lexer::Scanner::HASH);
+    run("line+dfa", fn, bytes, reps, Lexer::Mode::LINE, Lexer::Scanner::DFA);
+    run("mmap+hash", fn, bytes, reps, Lexer::Mode::MMAP, Lexer::Scanner::HASH);
+    run("mmap+dfa", fn, bytes, reps, Lexer::Mode::MMAP, Lexer::Scanner::DFA);
+
+    // Whole file into a TokenBuffer instead of token by token
+    std::cout << "\n";
+    run("batch+hash", fn, bytes, reps, 
+        Lexer::Mode::MMAP, Lexer::Scanner::HASH, true);
+    run("batch+dfa", fn, bytes, reps, 
+        Lexer::Mode::MMAP, Lexer::Scanner::DFA, true);
+
+    // Streaming through the SPSC ring from a lexer thread
+    std::cout << "\n";
+    run("pipe+hash", fn, bytes, reps,
+        Lexer::Mode::MMAP, Lexer::Scanner::HASH, false, 1, true);
+    run("pipe+dfa", fn, bytes, reps,
+        Lexer::Mode::MMAP, Lexer::Scanner::DFA, false, 1, true);
+
+    // Batch lexing split across threads, checked against the serial run
+    std::cout << "\n";
+    for (unsigned num_threads : {1u, 2u, 4u, 8u})
+    {
+        for (auto scanner : {Lexer::Scanner::HASH, Lexer::Scanner::DFA})
+        {
+            std::string name = 
+                std::string((scanner == Lexer::Scanner::HASH) ? "hash" : "dfa") +
+                "+" + std::to_string(num_threads) + "t";
+            run(name.c_str(), fn, bytes, reps, 
+                Lexer::Mode::MMAP, scanner, true, num_threads);
+
+            if (!sameAsSerial(fn, scanner, num_threads))
+            {
+                std::cerr << "[Error] bench: " << name 
+                          << " differs from the serial run\n";
+                exit(0);
+            }
+        }
+    }
+
+    // Run scanning helpers on their own, then the lexer, per SIMD level
+    const std::pair<const char*, SIMD::Level> levels[] =
+    {
+        {"scalar", SIMD::Level::SCALAR},
+        {"sse2", SIMD::Level::SSE2},
+        {"avx2", SIMD::Level::AVX2}
+    };
+    const auto best = SIMD::detect();
+
+    std::cout << "\n";
+    for (auto &[level_name, level] : levels)
+    {
+        if (level > best) continue;
+        SIMD::level = level;
+
+        std::string name = std::string("scan+") + level_name;
+        scan(name.c_str(), source.view(), reps);
+    }
+    for (auto &[level_name, level] : levels)
+    {
+        if (level > best) continue;
+        SIMD::level = level;
+
+        std::string name = std::string("hash+") + level_name;
+        run(name.c_str(), fn, bytes, reps,
+            Lexer::Mode::MMAP, Lexer::Scanner::HASH);
+        name = std::string("dfa+") + level_name;
+        run(name.c_str(), fn, bytes, reps,
+            Lexer::Mode::MMAP, Lexer::Scanner::DFA);
+    }
+    SIMD::level = best;
+}
@@ -0,0 +1,176 @@
+#ifndef __DFA_HH__
+#define __DFA_HH__
+
+#include "lexer/keywords.hh"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace Frontend
+{
+/*
+ * Compile-time tables for the table-driven scanner.
+ *
+ * Every byte is first mapped to a character class through a 256-entry
+ * table. A token run (identifier, keyword or number) is then recognized by
+ * walking a transition table indexed by [state][class] until a class that
+ * ends the run (space, tab or separator) shows up. The final state tells
+ * the token type directly - keywords are spelled out as a trie inside the
+ * state machine, so no hashing is needed once the run is over.
+ * */
+namespace DFA
+{
+// Character classes
+enum CharClass : uint8_t
+{
+    CC_OTHER, // anything that may appear in an identifier
+    CC_SPACE, // ' ', '\t'
+    CC_SEP,   // single character separators, see sep_list
+    CC_MINUS, // '-', either a separator or the sign of a number
+    CC_SLASH, // '/', either a separator or the start of a comment
+    CC_DIGIT, // '0' - '9'
+    CC_DOT,   // '.'
+    CC_EXP,   // 'E' - 'e' gets its own keyword-letter class
+    CC_LETTER // first class handed out to the letters used by keywords
+};
+constexpr unsigned NUM_CLASSES = CC_LETTER + 26;
+
+// Fixed states, trie states for keyword prefixes follow S_TRIE
+enum State : uint8_t
+{
+    S_DONE,  // the run is over
+    S_START, // nothing consumed yet
+    S_NEG,   // "-"
+    S_INT,   // "-?[0-9]+"
+    S_DOT,   // "[0-9]+."
+    S_LDOT,  // "."
+    S_FRAC,  // "[0-9]*.[0-9]+"
+    S_EXP,   // mantissa followed by 'e' or 'E'
+    S_EXPD,  // exponent digits
+    S_IDENT, // anything else
+    S_TRIE
+};
+constexpr unsigned MAX_STATES = 64;
+
+// What a state means when the run ends there
+enum class Accept : uint8_t { IDENT, INT, FLOAT, KEYWORD };
+
+// Pre-defined seperators
+inline constexpr std::pair<char, Token::TokenType> sep_list[] =
+{
+    {'=', Token::TokenType::TOKEN_ASSIGN},
+    {'+', Token::TokenType::TOKEN_PLUS},
+    {'-', Token::TokenType::TOKEN_MINUS},
+    {'!', Token::TokenType::TOKEN_BANG},
+    {'*', Token::TokenType::TOKEN_ASTERISK},
+    {'/', Token::TokenType::TOKEN_SLASH},
+    {'<', Token::TokenType::TOKEN_LT},
+    {'>', Token::TokenType::TOKEN_GT},
+    {',', Token::TokenType::TOKEN_COMMA},
+    {';', Token::TokenType::TOKEN_SEMICOLON},
+    {'(', Token::TokenType::TOKEN_LPAREN},
+    {')', Token::TokenType::TOKEN_RPAREN},
+    {'{', Token::TokenType::TOKEN_LBRACE},
+    {'}', Token::TokenType::TOKEN_RBRACE},
+    {'[', Token::TokenType::TOKEN_LBRACKET},
+    {']', Token::TokenType::TOKEN_RBRACKET},
+    {'&', Token::TokenType::TOKEN_AMPERSAND}
+};
+
+struct Tables
+{
+    std::array<uint8_t, 256> cls{};
+    std::array<Token::TokenType, 256> sep_type{};
+    std::array<std::array<uint8_t, NUM_CLASSES>, MAX_STATES> next{};
+    std::array<Accept, MAX_STATES> accept{};
+    std::array<Token::TokenType, MAX_STATES> keyword{};
+    unsigned num_states = S_TRIE;
+
+    constexpr Tables()
+    {
+        // (1) character classes
+        cls[(unsigned char)' '] = CC_SPACE;
+        cls[(unsigned char)'\t'] = CC_SPACE;
+        for (auto &[c, type] : sep_list)
+        {
+            cls[(unsigned char)c] = CC_SEP;
+            sep_type[(unsigned char)c] = type;
+        }
+        cls[(unsigned char)'-'] = CC_MINUS;
+        cls[(unsigned char)'/'] = CC_SLASH;
+        for (char c = '0'; c <= '9'; c++) cls[(unsigned char)c] = CC_DIGIT;
+        cls[(unsigned char)'.'] = CC_DOT;
+        cls[(unsigned char)'E'] = CC_EXP;
+
+        uint8_t letter_cls = CC_LETTER;
+        for (auto &[word, type] : Keywords::keyword_list)
+        {
+            for (auto c : word)
+            {
+                if (cls[(unsigned char)c] == CC_OTHER)
+                    cls[(unsigned char)c] = letter_cls++;
+            }
+        }
+        const uint8_t cls_e = cls[(unsigned char)'e'];
+
+        // (2) by default every run character leads to an identifier and
+        //     every run breaker ends the run
+        for (unsigned s = S_START; s < MAX_STATES; s++)
+        {
+            for (unsigned c = 0; c < NUM_CLASSES; c++)
+            {
+                next[s][c] = (c == CC_SPACE || c == CC_SEP ||
+                              c == CC_MINUS || c == CC_SLASH) ?
+                             S_DONE : S_IDENT;
+            }
+            accept[s] = Accept::IDENT;
+        }
+
+        // (3) numbers - the same shapes std::istream accepts
+        next[S_START][CC_DIGIT] = S_INT;
+        next[S_START][CC_DOT] = S_LDOT;
+        next[S_NEG][CC_DIGIT] = S_INT;
+        next[S_INT][CC_DIGIT] = S_INT;
+        next[S_INT][CC_DOT] = S_DOT;
+        next[S_INT][CC_EXP] = S_EXP;
+        next[S_INT][cls_e] = S_EXP;
+        next[S_DOT][CC_DIGIT] = S_FRAC;
+        next[S_DOT][CC_EXP] = S_EXP;
+        next[S_DOT][cls_e] = S_EXP;
+        next[S_LDOT][CC_DIGIT] = S_FRAC;
+        next[S_FRAC][CC_DIGIT] = S_FRAC;
+        next[S_FRAC][CC_EXP] = S_EXP;
+        next[S_FRAC][cls_e] = S_EXP;
+        next[S_EXP][CC_DIGIT] = S_EXPD;
+        next[S_EXPD][CC_DIGIT] = S_EXPD;
+
+        accept[S_INT] = Accept::INT;
+        accept[S_DOT] = Accept::FLOAT;
+        accept[S_FRAC] = Accept::FLOAT;
+        accept[S_EXPD] = Accept::FLOAT;
+
+        // (4) keywords - one trie state per distinct prefix
+        for (auto &[word, type] : Keywords::keyword_list)
+        {
+            unsigned s = S_START;
+            for (auto c : word)
+            {
+                auto c_cls = cls[(unsigned char)c];
+                if (next[s][c_cls] == S_IDENT)
+                    next[s][c_cls] = num_states++;
+                s = next[s][c_cls];
+            }
+            accept[s] = Accept::KEYWORD;
+            keyword[s] = type;
+        }
+    }
+};
+
+inline constexpr Tables tables{};
+static_assert(tables.num_states <= MAX_STATES, "too many DFA states");
+}
+}
+
+#endif
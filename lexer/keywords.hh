@@ -0,0 +1,117 @@
+#ifndef __KEYWORDS_HH__
+#define __KEYWORDS_HH__
+
+#include <array>
+#include <string_view>
+#include <utility>
+
+namespace Frontend
+{
+/*
+ * Keyword recognition through a perfect hash generated at compile time.
+ *
+ * The hash only looks at the length and the first/last characters of a
+ * word. The two multipliers are searched by the compiler so that every
+ * keyword lands in its own slot, so a lookup is one hash, one table load
+ * and one length-checked compare - no allocation and no runtime setup.
+ * */
+namespace Keywords
+{
+// Pre-defined keywords
+inline constexpr std::pair<std::string_view, Token::TokenType> keyword_list[] =
+{
+    {"return", Token::TokenType::TOKEN_RETURN},
+
+    {"void", Token::TokenType::TOKEN_DES_VOID},
+    {"int", Token::TokenType::TOKEN_DES_INT},
+    {"float", Token::TokenType::TOKEN_DES_FLOAT},
+
+    {"if", Token::TokenType::TOKEN_IF},
+    {"else", Token::TokenType::TOKEN_ELSE},
+    {"for", Token::TokenType::TOKEN_FOR},
+    {"while", Token::TokenType::TOKEN_WHILE}
+};
+
+constexpr unsigned TABLE_SIZE = 16;
+
+constexpr unsigned hash(std::string_view word, unsigned mul_first,
+                                                unsigned mul_last)
+{
+    return ((unsigned char)word.front() * mul_first +
+            (unsigned char)word.back() * mul_last +
+            word.size()) % TABLE_SIZE;
+}
+
+struct Slot
+{
+    std::string_view word;
+    Token::TokenType type = Token::TokenType::TOKEN_IDENTIFIER;
+};
+
+struct Table
+{
+    std::array<Slot, TABLE_SIZE> slots{};
+    unsigned mul_first = 0;
+    unsigned mul_last = 0;
+    size_t min_len = ~size_t(0);
+    size_t max_len = 0;
+
+    constexpr Table()
+    {
+        for (auto &[word, type] : keyword_list)
+        {
+            min_len = (word.size() < min_len) ? word.size() : min_len;
+            max_len = (word.size() > max_len) ? word.size() : max_len;
+        }
+
+        // Search the smallest multipliers without collisions
+        for (unsigned first = 1; first < 64 && mul_first == 0; first++)
+        {
+            for (unsigned last = 1; last < 64 && mul_first == 0; last++)
+            {
+                bool used[TABLE_SIZE] = {};
+                bool perfect = true;
+                for (auto &[word, type] : keyword_list)
+                {
+                    auto h = hash(word, first, last);
+                    perfect = perfect && !used[h];
+                    used[h] = true;
+                }
+
+                if (perfect)
+                {
+                    mul_first = first;
+                    mul_last = last;
+                }
+            }
+        }
+
+        for (auto &[word, type] : keyword_list)
+        {
+            auto &slot = slots[hash(word, mul_first, mul_last)];
+            slot.word = word;
+            slot.type = type;
+        }
+    }
+};
+
+inline constexpr Table table{};
+static_assert(table.mul_first != 0, "no perfect hash for the keywords");
+
+// Keyword token type of a word, TOKEN_IDENTIFIER if it is not a keyword
+constexpr Token::TokenType lookup(std::string_view word)
+{
+    if (word.size() < table.min_len || word.size() > table.max_len)
+        return Token::TokenType::TOKEN_IDENTIFIER;
+
+    auto &slot = table.slots[hash(word, table.mul_first, table.mul_last)];
+    return (slot.word == word) ? slot.type :
+                                 Token::TokenType::TOKEN_IDENTIFIER;
+}
+
+static_assert(lookup("while") == Token::TokenType::TOKEN_WHILE);
+static_assert(lookup("whale") == Token::TokenType::TOKEN_IDENTIFIER);
+}
+}
+
+#endif
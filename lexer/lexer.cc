@@ -1,7 +1,13 @@
 #include "lexer/lexer.hh"
+#include "lexer/dfa.hh"
+#include "lexer/simd.hh"
 
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 namespace Frontend
 {
@@ -76,10 +82,20 @@ std::string Token::prinTokenType()
     }
 }
 
-Lexer::Lexer(const char* fn)
+Lexer::Lexer(const char* fn, Mode _mode, Scanner _scanner)
+    : mode(_mode)
+    , scanner(_scanner)
 {
-    code.open(fn);
-    assert(code.good());
+    if (mode == Mode::LINE)
+    {
+        code.open(fn);
+        assert(code.good());
+    }
+    else
+    {
+        source.open(fn);
+        cursor = source.begin();
+    }
 
     // fill pre-defined seperators
     seps.insert({'=', Token::TokenType::TOKEN_ASSIGN});
@@ -99,78 +115,207 @@ Lexer::Lexer(const char* fn)
     seps.insert({'[', Token::TokenType::TOKEN_LBRACKET});
     seps.insert({']', Token::TokenType::TOKEN_RBRACKET});
     seps.insert({'&', Token::TokenType::TOKEN_AMPERSAND});
+}
 
-    // fill pre-defined keywords
-    keywords.insert({"return", Token::TokenType::TOKEN_RETURN});
+bool Lexer::getToken(Token &tok)
+{
+    // Skip empty lines
+    while (toks_per_line_idx == toks_per_line.size())
+    {
+        std::string_view line;
+        uint32_t offset;
 
-    keywords.insert({"void", Token::TokenType::TOKEN_DES_VOID});
-    keywords.insert({"int", Token::TokenType::TOKEN_DES_INT});
-    keywords.insert({"float", Token::TokenType::TOKEN_DES_FLOAT});
+        // Return if EOF
+        if (!nextLine(line, offset))
+        {
+            tok = Token(Token::TokenType::TOKEN_EOF);
+            return false;
+        }
 
-    keywords.insert({"if", Token::TokenType::TOKEN_IF});
-    keywords.insert({"else", Token::TokenType::TOKEN_ELSE});
-    keywords.insert({"for", Token::TokenType::TOKEN_FOR});
-    keywords.insert({"while", Token::TokenType::TOKEN_WHILE});
+        // Parse the line
+        toks_per_line.reset(line, offset);
+        toks_per_line_idx = 0;
+        scan(line, toks_per_line, symbols);
+    }
+
+    tok = toks_per_line.token(toks_per_line_idx++);
+    return true;
 }
 
-bool Lexer::getToken(Token &tok)
+void Lexer::tokenize(TokenBuffer &toks, unsigned num_threads)
 {
-    // Check if toks_per_line is empty or not
-    if (toks_per_line.size())
+    std::string_view text;
+    if (mode == Mode::LINE)
     {
-        tok = toks_per_line.front();
-        toks_per_line.pop();
-        return true;
+        // Slurp the rest of the stream, the buffer needs one contiguous text
+        std::string rest((std::istreambuf_iterator<char>(code)),
+                          std::istreambuf_iterator<char>());
+        lines.push_back(std::move(rest));
+        text = lines.back();
     }
+    else
+    {
+        text = std::string_view(cursor, source.end() - cursor);
+    }
+    uint32_t text_offset = (mode == Mode::LINE) ? line_offset : 
+                                                  cursor - source.begin();
+    auto text_end = text.data() + text.size();
+
+    // getline() drops a last line without '\n', so does LINE mode
+    bool drop_last = (mode == Mode::LINE);
 
-    // Read a line
-    std::string line;
-    getline(code, line);
+    // (1) split at newlines, a chunk under MIN_CHUNK is not worth a thread
+    constexpr size_t MIN_CHUNK = 64 * 1024;
+    num_threads = std::max(1u, std::min<unsigned>(num_threads,
+                                                  text.size() / MIN_CHUNK));
 
-    // Return if EOF
-    if (code.eof())
+    std::vector<const char*> bounds{text.data()};
+    for (unsigned i = 1; i < num_threads; i++)
     {
-        tok = Token(Token::TokenType::TOKEN_EOF);
-        return false;
-    }
+        auto split = text.data() + text.size() * i / num_threads;
+        if (split < bounds.back()) split = bounds.back();
 
-    // Parse the line
-    parseLine(line);
+        auto nl = static_cast<const char*>(
+                      memchr(split, '\n', text_end - split));
+        if (nl == nullptr) break;
+        bounds.push_back(nl + 1);
+    }
+    bounds.push_back(text_end);
+    auto num_chunks = bounds.size() - 1;
 
-    // Skip empty lines
-    while (toks_per_line.size() == 0)
+    if (num_chunks == 1)
     {
-        getline(code, line);
-        if (code.eof())
+        // Dense code runs at about one token per two bytes of source
+        toks.reset(text, text_offset);
+        toks.reserve(text.size() / 2);
+        lexRange(text.data(), text_end, drop_last, toks, symbols);
+    }
+    else
+    {
+        // (2) lex every chunk into its own buffer and symbol table
+        std::vector<TokenBuffer> chunk_toks(num_chunks);
+        std::vector<SymbolTable> chunk_syms(num_chunks);
+        auto lexChunk = [&](size_t i)
         {
-            tok = Token(Token::TokenType::TOKEN_EOF);
-            return false;
+            chunk_toks[i].reset(text, text_offset);
+            chunk_toks[i].reserve((bounds[i + 1] - bounds[i]) / 2);
+            lexRange(bounds[i], bounds[i + 1], 
+                     drop_last && i == num_chunks - 1,
+                     chunk_toks[i], chunk_syms[i]);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < num_chunks; i++)
+            workers.emplace_back(lexChunk, i);
+        lexChunk(0);
+        for (auto &worker : workers) worker.join();
+
+        // (3) intern the chunk symbols in chunk order, which hands out the
+        //     same IDs a serial run would
+        std::vector<std::vector<Symbol>> remaps(num_chunks);
+        std::vector<size_t> starts(num_chunks + 1, 0);
+        for (size_t i = 0; i < num_chunks; i++)
+        {
+            remaps[i].resize(chunk_syms[i].size());
+            for (Symbol sym = 0; sym < chunk_syms[i].size(); sym++)
+                remaps[i][sym] = symbols.intern(chunk_syms[i].name(sym));
+            starts[i + 1] = starts[i] + chunk_toks[i].size();
         }
 
-        parseLine(line);
+        // (4) concatenate, again one thread per chunk
+        toks.reset(text, text_offset);
+        toks.resize(starts[num_chunks]);
+        auto copyChunk = [&](size_t i)
+        {
+            toks.copyFrom(starts[i], chunk_toks[i], remaps[i]);
+        };
+
+        workers.clear();
+        for (size_t i = 1; i < num_chunks; i++)
+            workers.emplace_back(copyChunk, i);
+        copyChunk(0);
+        for (auto &worker : workers) worker.join();
+    }
+
+    if (mode == Mode::LINE)
+        line_offset += text.size();
+    else
+        cursor = source.end();
+}
+
+void Lexer::lexRange(const char* begin, const char* end, bool drop_last,
+                     TokenBuffer &toks, SymbolTable &syms)
+{
+    std::string_view line;
+    auto iter = begin;
+    while (cutLine(iter, end, line))
+    {
+        if (drop_last && line.data() + line.size() == iter)
+            break;
+
+        scan(line, toks, syms);
     }
+}
+
+bool Lexer::nextLine(std::string_view &line, uint32_t &offset)
+{
+    if (mode == Mode::LINE)
+    {
+        // Read a line
+        std::string cur_line;
+        getline(code, cur_line);
+
+        if (code.eof()) return false;
+
+        lines.push_back(std::move(cur_line));
+        line = lines.back();
+        offset = line_offset;
+        line_offset += line.size() + 1;
+        return true;
+    }
+
+    // MMAP - cut the next line out of the mapping, no copies
+    offset = cursor - source.begin();
+    return cutLine(cursor, source.end(), line);
+}
+
+bool Lexer::cutLine(const char* &iter, const char* end, std::string_view &line)
+{
+    if (iter == end) return false;
+
+    auto nl = static_cast<const char*>(memchr(iter, '\n', end - iter));
+    auto line_end = (nl != nullptr) ? nl : end;
 
-    assert(toks_per_line.size() != 0);
-    // std::cout << "\n" << line << "\n";
-    tok = toks_per_line.front();
-    toks_per_line.pop();
+    line = std::string_view(iter, line_end - iter);
+    iter = (nl != nullptr) ? nl + 1 : end;
     return true;
 }
 
-void Lexer::parseLine(std::string &line)
+void Lexer::parseLine(std::string_view line, TokenBuffer &toks, 
+                      SymbolTable &syms)
 {
-    std::shared_ptr<std::string> cur_line = 
-        std::make_shared<std::string>(line);
+    auto begin = line.data();
+    auto end = line.data() + line.size();
+
+    // The character after iter, or '\0' past the end of the line
+    auto peek = [end](const char* iter)
+    {
+        return (iter + 1 != end) ? *(iter + 1) : '\0';
+    };
 
     // Extract all the tokens from the current line
-    for (auto iter = line.begin(); iter != line.end(); iter++)
+    for (auto iter = begin; iter != end; iter++)
     {
         // (1) skip space, tab, and comments
-        if (*iter == ' ' || *iter == '\t') continue;
-        if (*iter == '/'  && *(iter + 1) == '/') break;
+        if (*iter == ' ' || *iter == '\t')
+        {
+            iter = SIMD::skipBlanks(iter, end) - 1;
+            continue;
+        }
+        if (*iter == '/'  && peek(iter) == '/') break;
 
         // start to process token
-        std::string cur_token_str(1, *iter);
+        auto tok_begin = iter;
 
         // (2) is it a sep?
         if (auto sep_iter = seps.find(*iter); 
@@ -181,66 +326,180 @@ void Lexer::parseLine(std::string &line)
 
 	    // note the lookahead to require that negative literals are numeric
     	    if (type == Token::TokenType::TOKEN_MINUS) {
-	       std::string::iterator prev = findPrevNonEmptyChar(iter, line.begin());
-	       binary_minus = !std::isdigit(*(iter + 1)) || *prev == ']'|| std::isalnum(*prev);
+	       auto prev = findPrevNonEmptyChar(iter, begin);
+	       binary_minus = !std::isdigit(peek(iter)) || *prev == ']'|| std::isalnum(*prev);
 	    }	    
 
 	    if (binary_minus) {
-               std::string literal = cur_token_str;
-               Token _tok(type, literal, cur_line);
-               toks_per_line.push(_tok);
+               toks.push(type, tok_begin, 1);
                continue;
 	    }
         }
 
-        // (3) parse the token
-        auto next = iter + 1;
-        while (next != line.end())
-        {
-            auto next_sep_check = seps.find(*next);
+        // (3) parse the token, it runs until the next space, tab or sep
+        auto next = SIMD::findBreak(iter + 1, end);
+        iter = next - 1;
+        std::string_view cur_token_str(tok_begin, next - tok_begin);
 
-            if ((*next == ' ') || (*next == '\t') || (next_sep_check != seps.end()))
-            {
-                break;
-            }
-            cur_token_str.push_back(*next);
-            next++;
-            iter++;
-        }
+        // from_chars also spells "inf" and "nan", only try real numbers
+        char first = cur_token_str[0];
+        bool maybe_number = std::isdigit((unsigned char)first) || 
+                            first == '.' || first == '-';
 
-        if (isType<int>(cur_token_str))
+        Token::Value value = {0};
+        if (maybe_number && parseInt(cur_token_str, value.i))
         {
-            Token::TokenType type = Token::TokenType::TOKEN_INT;
-            Token _tok(type, cur_token_str, cur_line);
-            toks_per_line.push(_tok);
+            toks.push(Token::TokenType::TOKEN_INT, tok_begin,
+                      cur_token_str.size(), value);
             continue;
         }
-        else if (isType<float>(cur_token_str))
+        else if (maybe_number && parseFloat(cur_token_str, value.f))
         {
-            Token::TokenType type = Token::TokenType::TOKEN_FLOAT;
-            Token _tok(type, cur_token_str, cur_line);
-            toks_per_line.push(_tok);
+            toks.push(Token::TokenType::TOKEN_FLOAT, tok_begin,
+                      cur_token_str.size(), value);
             continue;
         }
 
         // is the token keywork?
-        if (auto k_iter = keywords.find(cur_token_str);
-            k_iter != keywords.end())
+        Token::TokenType type = Keywords::lookup(cur_token_str);
+        if (type == Token::TokenType::TOKEN_IDENTIFIER)
+            value.sym = syms.intern(cur_token_str);
+        toks.push(type, tok_begin, cur_token_str.size(), value);
+    }
+}
+
+void Lexer::scanLine(std::string_view line, TokenBuffer &toks,
+                     SymbolTable &syms)
+{
+    using namespace DFA;
+
+    auto begin = line.data();
+    auto end = line.data() + line.size();
+
+    // Only spaces and tabs separate tokens, so the previous non-empty
+    // character is always the last character of the previous token.
+    char prev = '\0';
+
+    auto iter = begin;
+    while (iter != end)
+    {
+        auto tok_begin = iter;
+        char next = (iter + 1 != end) ? *(iter + 1) : '\0';
+
+        uint8_t state;
+        switch (tables.cls[(unsigned char)*iter])
         {
-            std::string literal = cur_token_str;
-            Token::TokenType type = k_iter->second;
-            Token _tok(type, literal, cur_line);
+            // (1) skip space, tab, and comments
+            case CC_SPACE:
+                iter = SIMD::skipBlanks(iter, end);
+                continue;
+
+            case CC_SLASH:
+                if (next == '/') return;
+                [[fallthrough]];
 
-            toks_per_line.push(_tok);
+            // (2) single character seperators
+            case CC_SEP:
+            {
+                toks.push(tables.sep_type[(unsigned char)*iter], tok_begin, 1);
+                prev = *iter++;
+                continue;
+            }
+
+            // note the lookahead to require that negative literals are numeric
+            case CC_MINUS:
+                if (!std::isdigit((unsigned char)next) || prev == ']' ||
+                    std::isalnum((unsigned char)prev))
+                {
+                    toks.push(Token::TokenType::TOKEN_MINUS, tok_begin, 1);
+                    prev = *iter++;
+                    continue;
+                }
+                state = S_NEG;
+                break;
+
+            default:
+                state = tables.next[S_START][tables.cls[(unsigned char)*iter]];
+                break;
         }
-        else
+
+        // (3) run the state machine until the token ends
+        iter++;
+        while (iter != end)
         {
-	    std::string literal = cur_token_str;
-            Token::TokenType type = Token::TokenType::TOKEN_IDENTIFIER;
-            Token _tok(type, literal, cur_line);
+            // Identifiers only end at a break character, find it in bulk
+            if (state == S_IDENT)
+            {
+                iter = SIMD::findBreak(iter, end);
+                break;
+            }
+
+            uint8_t next_state = 
+                tables.next[state][tables.cls[(unsigned char)*iter]];
+            if (next_state == S_DONE) break;
+
+            state = next_state;
+            iter++;
+        }
+        std::string_view cur_token_str(tok_begin, iter - tok_begin);
+        prev = *(iter - 1);
+
+        // (4) the final state is the token type
+        Token::TokenType type = Token::TokenType::TOKEN_IDENTIFIER;
+        Token::Value value = {0};
+        switch (tables.accept[state])
+        {
+            case Accept::KEYWORD:
+                type = tables.keyword[state];
+                break;
+
+            // Literals that do not fit their type are identifiers
+            case Accept::INT:
+                if (parseInt(cur_token_str, value.i))
+                {
+                    type = Token::TokenType::TOKEN_INT;
+                    break;
+                }
+                [[fallthrough]];
+
+            case Accept::FLOAT:
+                if (parseFloat(cur_token_str, value.f))
+                    type = Token::TokenType::TOKEN_FLOAT;
+                break;
 
-            toks_per_line.push(_tok);
+            default:
+                break;
         }
+
+        if (type == Token::TokenType::TOKEN_IDENTIFIER)
+            value.sym = syms.intern(cur_token_str);
+        toks.push(type, tok_begin, cur_token_str.size(), value);
+    }
+}
+
+bool Lexer::parseInt(std::string_view str, int32_t &val)
+{
+    auto end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, val);
+
+    // Out-of-range integers fall through to float, like istream does
+    return ec == std::errc() && ptr == end;
+}
+
+bool Lexer::parseFloat(std::string_view str, float &val)
+{
+    auto end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, val);
+    if (ptr != end) return false;
+    if (ec == std::errc()) return true;
+
+    // from_chars reports overflow and underflow alike, while istream only
+    // rejects overflow. Tell the two apart on this (rare) slow path.
+    if (ec == std::errc::result_out_of_range)
+    {
+        val = strtof(std::string(str).c_str(), nullptr);
+        return !std::isinf(val);
     }
+    return false;
 }
 }
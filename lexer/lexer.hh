@@ -1,12 +1,19 @@
 #ifndef __LEXER_HH__
 #define __LEXER_HH__
 
+#include "lexer/source.hh"
+#include "lexer/symbols.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <deque>
 #include <fstream>
 #include <memory>
-#include <queue>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace Frontend
 {
@@ -91,8 +98,21 @@ struct Token
         TOKEN_WHILE
     } type = TokenType::TOKEN_ILLEGAL;
 
-    // literal - container of the token value
-    std::string literal = "";
+    // literal - view of the token text inside the source buffer
+    std::string_view literal;
+
+    // offset - byte offset of the token inside the source file, the
+    //          line and column are only worked out for diagnostics
+    uint32_t offset = 0;
+
+    // value - pre-parsed value of INT/FLOAT tokens, the interned
+    //         symbol of IDENTIFIER tokens
+    union Value
+    {
+        int32_t i;
+        float f;
+        Symbol sym;
+    } value = {0};
 
     // default constructor
     Token() {}
@@ -105,7 +125,7 @@ struct Token
     }
 
     // alternative constructor
-    Token(TokenType _type, std::string &_val)
+    Token(TokenType _type, std::string_view _val)
         : type(_type)
         , literal(_val)
     {
@@ -114,20 +134,11 @@ struct Token
 
     // alternative constructor
     Token(TokenType _type, 
-          std::string &_val, 
-          std::shared_ptr<std::string> &_line)
+          std::string_view _val, 
+          uint32_t _offset)
         : type(_type)
         , literal(_val)
-        , line(_line)
-    {
-    
-    }
-
-    // copy constructor
-    Token(const Token &_tok)
-        : type(_tok.type)
-        , literal(_tok.literal)
-        , line(_tok.line)
+        , offset(_offset)
     {
     
     }
@@ -135,7 +146,11 @@ struct Token
     // return token type string (implemented in lexer.cc)
     std::string prinTokenType();
 
-    auto &getLiteral() { return literal; }
+    auto getLiteral() { return literal; }
+    auto getInt() { return value.i; }
+    auto getFloat() { return value.f; }
+    auto getOffset() { return offset; }
+    Symbol getSymbol() { return isTokenIden() ? value.sym : NO_SYMBOL; }
     auto &getTokenType() { return type; }
 
     bool isTokenIden() { return type == TokenType::TOKEN_IDENTIFIER; }
@@ -177,36 +192,234 @@ struct Token
     bool isTokenElse() { return type == TokenType::TOKEN_ELSE; }
     bool isTokenFor() { return type == TokenType::TOKEN_FOR; }
     bool isTokenWhile() { return type == TokenType::TOKEN_WHILE; }
+};
+
+/*
+ * Token storage as parallel arrays (structure of arrays).
+ *
+ * Offsets are relative to the text the buffer was reset to, so a buffer
+ * can hold a single line (streaming getToken) or a whole file (tokenize).
+ * A full Token is only materialized on request; indices past the end
+ * read as EOF, which gives the parser unbounded lookahead for free.
+ * */
+class TokenBuffer
+{
+  protected:
+    // text the offsets point into, and where it starts in the file
+    std::string_view text;
+    uint32_t text_offset = 0;
+
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<Token::Value> values;
+
+    // built on the first diagnostic only
+    mutable LineTable line_table;
+
+    static_assert((int)Token::TokenType::TOKEN_WHILE < 256,
+                  "token types must fit into uint8_t");
+
+  public:
+    void reset(std::string_view _text, uint32_t _text_offset = 0)
+    {
+        text = _text;
+        text_offset = _text_offset;
+        line_table.reset(text);
+
+        types.clear();
+        offsets.clear();
+        lengths.clear();
+        values.clear();
+    }
+
+    void reserve(size_t num_toks)
+    {
+        types.reserve(num_toks);
+        offsets.reserve(num_toks);
+        lengths.reserve(num_toks);
+        values.reserve(num_toks);
+    }
+
+    // Grow to num_toks tokens, the new ones are filled in by copyFrom
+    void resize(size_t num_toks)
+    {
+        types.resize(num_toks);
+        offsets.resize(num_toks);
+        lengths.resize(num_toks);
+        values.resize(num_toks);
+    }
+
+    // Copy all the tokens of other to index at. Both buffers must be reset
+    // to the same text; identifier symbols are renumbered through remap.
+    void copyFrom(size_t at, const TokenBuffer &other,
+                  const std::vector<Symbol> &remap)
+    {
+        std::copy(other.types.begin(), other.types.end(), 
+                  types.begin() + at);
+        std::copy(other.offsets.begin(), other.offsets.end(), 
+                  offsets.begin() + at);
+        std::copy(other.lengths.begin(), other.lengths.end(), 
+                  lengths.begin() + at);
+        for (size_t i = 0; i < other.size(); i++)
+        {
+            values[at + i] = other.values[i];
+            if (other.type(i) == Token::TokenType::TOKEN_IDENTIFIER)
+                values[at + i].sym = remap[other.values[i].sym];
+        }
+    }
+
+    void push(Token::TokenType type, const char* begin, uint32_t length,
+              Token::Value value = {0})
+    {
+        types.push_back((uint8_t)type);
+        offsets.push_back(begin - text.data());
+        lengths.push_back(length);
+        values.push_back(value);
+    }
+
+    size_t size() const { return types.size(); }
 
-    std::shared_ptr<std::string> line;
-    std::string& getLine() { return *line; }
+    Token::TokenType type(size_t idx) const
+    {
+        return (idx < types.size()) ? (Token::TokenType)types[idx] :
+                                      Token::TokenType::TOKEN_EOF;
+    }
+
+    std::string_view literal(size_t idx) const
+    {
+        if (idx >= types.size()) return std::string_view();
+        return text.substr(offsets[idx], lengths[idx]);
+    }
+
+    // byte offset inside the source file
+    uint32_t offset(size_t idx) const
+    {
+        return (idx < types.size()) ? text_offset + offsets[idx] : 0;
+    }
+
+    Token::Value value(size_t idx) const
+    {
+        return (idx < types.size()) ? values[idx] : Token::Value{0};
+    }
+
+    // line and column of a token, EOF sits at the end of the text.
+    // Lines count from the start of the text the buffer was reset to.
+    LineTable::Location location(size_t idx) const
+    {
+        return line_table.locate((idx < types.size()) ? offsets[idx] : 
+                                                        text.size());
+    }
+
+    // source line the token sits on (for error messages)
+    std::string_view line(size_t idx) const
+    {
+        return line_table.lineText(location(idx).line);
+    }
+
+    Token token(size_t idx) const
+    {
+        if (idx >= types.size()) return Token(Token::TokenType::TOKEN_EOF);
+
+        Token tok(type(idx), literal(idx), offset(idx));
+        tok.value = values[idx];
+        return tok;
+    }
 };
 
 class Lexer
 {
+  public:
+    // How the source file is brought into memory
+    enum class Mode : int
+    {
+        // LINE - read line by line through std::ifstream
+        LINE,
+        // MMAP - map the whole file, tokens are views into the mapping
+        MMAP
+    };
+
+    // How a line is cut into tokens
+    enum class Scanner : int
+    {
+        // HASH - seps hash map per token start, SIMD run scanning
+        HASH,
+        // DFA - character-class table plus compiled state machine
+        DFA
+    };
+
   protected:
-    // define seperators
+    // define seperators (keywords live in lexer/keywords.hh)
     std::unordered_map<char, Token::TokenType> seps;
-    // define keywords
-    std::unordered_map<std::string, Token::TokenType> keywords;
 
   protected:
+    Mode mode;
+    Scanner scanner;
+
+    // LINE mode - the stream and the storage backing the token views.
+    // A deque never relocates its elements, so views stay valid.
     std::ifstream code;
+    std::deque<std::string> lines;
+    uint32_t line_offset = 0;
+
+    // MMAP mode - the mapping and the start of the next unscanned line
+    SourceBuffer source;
+    const char *cursor = nullptr;
 
-    std::queue<Token> toks_per_line;
+    // getToken - tokens of the current line and the next one to hand out
+    TokenBuffer toks_per_line;
+    size_t toks_per_line_idx = 0;
+
+    // every identifier seen so far, IDs are handed out in source order
+    SymbolTable symbols;
 
   public:
-    Lexer(const char*);
-    ~Lexer() { code.close(); };
+    Lexer(const char*, Mode _mode = Mode::MMAP,
+                       Scanner _scanner = Scanner::DFA);
+    ~Lexer() { if (code.is_open()) code.close(); };
 
+    // Streaming interface, one token at a time
     bool getToken(Token&);
+
+    // Batch interface, lex the rest of the file into toks. With more than
+    // one thread the text is split at newlines and the chunks are lexed in
+    // parallel; the result (symbols included) is the same as serial.
+    void tokenize(TokenBuffer &toks, unsigned num_threads = 1);
+
+    auto &getSymbols() { return symbols; }
+
+    // Whole mapped file (MMAP mode), what token offsets are relative to
+    std::string_view getSource() { return source.view(); }
     
   protected:
-    void parseLine(std::string &line);
+    bool nextLine(std::string_view &line, uint32_t &offset);
+    static bool cutLine(const char* &iter, const char* end,
+                        std::string_view &line);
+
+    // Lex every line in [begin, end), drop_last skips a last line that
+    // has no '\n' (LINE mode)
+    void lexRange(const char* begin, const char* end, bool drop_last,
+                  TokenBuffer &toks, SymbolTable &syms);
+
+    // Both scanners append the tokens of line to toks and intern the
+    // identifiers into syms. The line must lie inside the text toks was
+    // reset to. Nothing else is written, so threads can scan disjoint
+    // lines as long as each has its own toks and syms.
+    void scan(std::string_view line, TokenBuffer &toks, SymbolTable &syms)
+    {
+        if (scanner == Scanner::DFA)
+            scanLine(line, toks, syms);
+        else
+            parseLine(line, toks, syms);
+    }
+    void parseLine(std::string_view line, TokenBuffer &toks, 
+                   SymbolTable &syms);
+    void scanLine(std::string_view line, TokenBuffer &toks,
+                  SymbolTable &syms);
 
     // helper function
-    std::string::iterator findPrevNonEmptyChar(std::string::iterator current, 
-                                               std::string::iterator begin) 
+    const char* findPrevNonEmptyChar(const char* current, 
+                                     const char* begin) 
     {
         // Move backwards from the current position
         auto iter = current;
@@ -225,15 +438,10 @@ class Lexer
     }
 
 
-    template<typename T>
-    bool isType(std::string &cur_token_str)
-    {
-        std::istringstream iss(cur_token_str);
-        T float_check;
-        iss >> std::noskipws >> float_check;
-        if (iss.eof() && !iss.fail()) return true;
-        else return false;
-    }
+    // Numeric literals are parsed straight out of the source text. Both
+    // accept exactly what "std::istream >> T" accepts for a whole token.
+    static bool parseInt(std::string_view str, int32_t &val);
+    static bool parseFloat(std::string_view str, float &val);
 };
 
 }
@@ -1,5 +1,7 @@
 #include "lexer/lexer.hh"
 
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -7,15 +9,55 @@ using namespace Frontend;
 
 int main(int argc, char* argv[])
 {
-    Lexer lexer(argv[1]);
+    // lexer [--line] [--hash] [--batch] [--threads N] <source>
+    //   --line  - use the line-by-line std::ifstream reader instead of
+    //             the memory-mapped one
+    //   --hash  - use the hash-map scanner instead of the DFA one
+    //   --batch - lex the whole file into a TokenBuffer first
+    //   --threads N - batch mode, lex the file in N chunks in parallel
+    Lexer::Mode mode = Lexer::Mode::MMAP;
+    Lexer::Scanner scanner = Lexer::Scanner::DFA;
+    bool batch = false;
+    unsigned num_threads = 1;
+    const char* fn = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--line") == 0)
+            mode = Lexer::Mode::LINE;
+        else if (strcmp(argv[i], "--hash") == 0)
+            scanner = Lexer::Scanner::HASH;
+        else if (strcmp(argv[i], "--batch") == 0)
+            batch = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            batch = true;
+            num_threads = atoi(argv[++i]);
+        }
+        else
+            fn = argv[i];
+    }
 
-    Token tok;
-    while (lexer.getToken(tok))
+    Lexer lexer(fn, mode, scanner);
+
+    auto print = [](Token &tok)
     {
-        
         std::cout << std::setw(12)
                   << tok.prinTokenType() << " | "
                   << tok.getLiteral() << "\n";
-        
+    };
+
+    if (batch)
+    {
+        TokenBuffer toks;
+        lexer.tokenize(toks, num_threads);
+        for (size_t i = 0; i < toks.size(); i++)
+        {
+            Token tok = toks.token(i);
+            print(tok);
+        }
+        return 0;
     }
+
+    Token tok;
+    while (lexer.getToken(tok)) print(tok);
 }
@@ -0,0 +1,68 @@
+#ifndef __PIPE_HH__
+#define __PIPE_HH__
+
+#include "lexer/lexer.hh"
+#include "lexer/ring.hh"
+
+#include <thread>
+
+namespace Frontend
+{
+/*
+ * Pipelined lexing - the lexer runs on its own thread and streams tokens
+ * to the consumer through a bounded SPSC ring, so reading and scanning the
+ * file overlap with parsing instead of running before it.
+ *
+ * While the pipe runs, the lexer (its symbol table included) belongs to
+ * the producer thread. The consumer must not touch it until it has popped
+ * EOF, after which pop() keeps returning EOF.
+ * */
+class TokenPipe
+{
+  protected:
+    // 4096 tokens of 32 bytes - enough to ride out scheduling hiccups,
+    // small enough to stay in L2
+    static constexpr size_t RING_SIZE = 4096;
+
+    SPSCRing<Token, RING_SIZE> ring;
+    std::thread producer;
+    bool done = false;
+
+  public:
+    TokenPipe() {}
+
+    TokenPipe(const TokenPipe&) = delete;
+    TokenPipe& operator=(const TokenPipe&) = delete;
+
+    // Drain whatever is left, the producer may be blocked on a full ring
+    ~TokenPipe() { while (producer.joinable()) pop(); }
+
+    void start(Lexer &lexer)
+    {
+        producer = std::thread([this, &lexer]()
+        {
+            Token tok;
+            while (lexer.getToken(tok)) ring.push(tok);
+
+            // getToken() left an EOF token in tok
+            ring.push(tok);
+        });
+    }
+
+    Token pop()
+    {
+        if (done) return Token(Token::TokenType::TOKEN_EOF);
+
+        Token tok;
+        ring.pop(tok);
+        if (tok.isTokenEOF())
+        {
+            done = true;
+            producer.join();
+        }
+        return tok;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef __RING_HH__
+#define __RING_HH__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+namespace Frontend
+{
+/*
+ * Bounded single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread pushes and exactly one thread pops. head and tail
+ * only ever grow, each is written by one side and read by the other, so
+ * a release store paired with an acquire load is all the synchronization
+ * needed - no locks, no read-modify-write.
+ *
+ * Each side keeps a private copy of the other side's index and only
+ * reloads it when the ring looks full (producer) or empty (consumer), so
+ * in the steady state the two threads do not bounce each other's cache
+ * lines on every element.
+ *
+ * A full ring blocks the producer, which keeps memory bounded no matter
+ * how far the lexer could run ahead of the parser.
+ * */
+template <typename T, size_t CAPACITY>
+class SPSCRing
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                  "capacity must be a power of two");
+
+  protected:
+    static constexpr size_t MASK = CAPACITY - 1;
+    static constexpr size_t CACHE_LINE = 64;
+
+    // Spins before a blocked side gives up its time slice
+    static constexpr unsigned SPINS = 64;
+
+    std::unique_ptr<T[]> slots = std::make_unique<T[]>(CAPACITY);
+
+    // consumer side - next slot to pop, producer's tail as last seen
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+
+    // producer side - next slot to push, consumer's head as last seen
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+
+  public:
+    // Producer only, false if the ring is full
+    bool tryPush(const T &elem)
+    {
+        auto cur_tail = tail.load(std::memory_order_relaxed);
+        if (cur_tail - cached_head == CAPACITY)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+            if (cur_tail - cached_head == CAPACITY) return false;
+        }
+
+        slots[cur_tail & MASK] = elem;
+        tail.store(cur_tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only, false if the ring is empty
+    bool tryPop(T &elem)
+    {
+        auto cur_head = head.load(std::memory_order_relaxed);
+        if (cur_head == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (cur_head == cached_tail) return false;
+        }
+
+        elem = slots[cur_head & MASK];
+        head.store(cur_head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Blocking versions, spin briefly then yield so a producer and a
+    // consumer sharing one core still make progress
+    void push(const T &elem)
+    {
+        for (unsigned spins = 0; !tryPush(elem); spins++)
+        {
+            if (spins >= SPINS) std::this_thread::yield();
+        }
+    }
+
+    void pop(T &elem)
+    {
+        for (unsigned spins = 0; !tryPop(elem); spins++)
+        {
+            if (spins >= SPINS) std::this_thread::yield();
+        }
+    }
+};
+}
+
+#endif
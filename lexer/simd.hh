@@ -0,0 +1,247 @@
+#ifndef __SIMD_HH__
+#define __SIMD_HH__
+
+#include "lexer/dfa.hh"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEXER_SIMD_X86
+#endif
+
+namespace Frontend
+{
+/*
+ * Vectorized run scanning for the lexer.
+ *
+ * Both scanners spend most of their time in two loops: skipping blanks
+ * and extending an identifier until a break character (space, tab or a
+ * separator) shows up. The helpers below answer both questions 16 (SSE2)
+ * or 32 (AVX2) bytes at a time and finish the last partial block with the
+ * scalar loop, so they never read past the end they are given.
+ *
+ * The break set is derived from the DFA character classes so the two
+ * cannot drift apart.
+ * */
+namespace SIMD
+{
+enum class Level : uint8_t { SCALAR, SSE2, AVX2 };
+
+inline Level detect()
+{
+#ifdef LEXER_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    return Level::SSE2;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+// Widest instruction set the CPU supports, lower it to compare paths
+inline Level level = detect();
+
+constexpr bool isBlank(unsigned char c)
+{
+    return DFA::tables.cls[c] == DFA::CC_SPACE;
+}
+
+constexpr bool isBreak(unsigned char c)
+{
+    auto c_cls = DFA::tables.cls[c];
+    return c_cls == DFA::CC_SPACE || c_cls == DFA::CC_SEP ||
+           c_cls == DFA::CC_MINUS || c_cls == DFA::CC_SLASH;
+}
+
+/*
+ * The break set in two shapes, both derived from the DFA classes above.
+ *
+ * AVX2 tests set membership with two nibble lookups (a.k.a. "shufti"):
+ * every distinct high nibble of the set gets its own bit and lo[n] holds
+ * the bits of the high nibbles that pair with low nibble n, so a byte is
+ * in the set iff lo[byte & 0xf] & hi[byte >> 4] is non-zero.
+ *
+ * SSE2 has no byte shuffle, it tests the runs of consecutive characters
+ * ("(),*+-" is one run) with one unsigned range compare each.
+ * */
+struct BreakSet
+{
+    std::array<uint8_t, 16> lo{};
+    std::array<uint8_t, 16> hi{};
+    unsigned num_groups = 0;
+
+    std::array<uint8_t, 32> range_first{};
+    std::array<uint8_t, 32> range_last{};
+    unsigned num_ranges = 0;
+
+    constexpr BreakSet()
+    {
+        for (unsigned c = 0; c < 128; c++)
+        {
+            if (!isBreak(c)) continue;
+
+            if (hi[c >> 4] == 0) hi[c >> 4] = 1 << num_groups++;
+            lo[c & 0xf] |= hi[c >> 4];
+
+            if (num_ranges != 0 && range_last[num_ranges - 1] + 1 == c)
+            {
+                range_last[num_ranges - 1] = c;
+                continue;
+            }
+            range_first[num_ranges] = c;
+            range_last[num_ranges] = c;
+            num_ranges++;
+        }
+    }
+};
+
+inline constexpr BreakSet break_set{};
+static_assert(break_set.num_groups <= 8, "break set needs too many groups");
+static_assert(!isBreak(0x80), "non-ASCII bytes must not break a run");
+
+// (1) scalar reference versions
+inline const char* skipBlanksScalar(const char* iter, const char* end)
+{
+    while (iter != end && isBlank(*iter)) iter++;
+    return iter;
+}
+
+inline const char* findBreakScalar(const char* iter, const char* end)
+{
+    while (iter != end && !isBreak(*iter)) iter++;
+    return iter;
+}
+
+#ifdef LEXER_SIMD_X86
+// (2) SSE2, part of the x86-64 baseline
+inline const char* skipBlanksSSE2(const char* iter, const char* end)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - iter >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iter));
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                     _mm_cmpeq_epi8(v, tab));
+        unsigned mask = ~_mm_movemask_epi8(blank) & 0xffff;
+        if (mask != 0) return iter + __builtin_ctz(mask);
+        iter += 16;
+    }
+    return skipBlanksScalar(iter, end);
+}
+
+inline const char* findBreakSSE2(const char* iter, const char* end)
+{
+    constexpr unsigned num_ranges = break_set.num_ranges;
+    while (end - iter >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iter));
+        __m128i hit = _mm_setzero_si128();
+#pragma GCC unroll 32
+        for (unsigned i = 0; i < num_ranges; i++)
+        {
+            // first <= c <= last  <=>  min(c - first, last - first) == c - first
+            __m128i off = _mm_sub_epi8(v,
+                            _mm_set1_epi8(break_set.range_first[i]));
+            __m128i width = _mm_set1_epi8(break_set.range_last[i] -
+                                          break_set.range_first[i]);
+            hit = _mm_or_si128(hit,
+                    _mm_cmpeq_epi8(_mm_min_epu8(off, width), off));
+        }
+        unsigned mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return iter + __builtin_ctz(mask);
+        iter += 16;
+    }
+    return findBreakScalar(iter, end);
+}
+
+// (3) AVX2, picked at runtime so the build does not need -mavx2
+__attribute__((target("avx2")))
+inline const char* skipBlanksAVX2(const char* iter, const char* end)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    while (end - iter >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter));
+        __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                        _mm256_cmpeq_epi8(v, tab));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(blank);
+        if (mask != 0) return iter + __builtin_ctz(mask);
+        iter += 32;
+    }
+    return skipBlanksSSE2(iter, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* findBreakAVX2(const char* iter, const char* end)
+{
+    const __m256i lo_tbl = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(break_set.lo.data())));
+    const __m256i hi_tbl = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(break_set.hi.data())));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    while (end - iter >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter));
+        __m256i lo = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(v, nibble));
+        __m256i hi = _mm256_shuffle_epi8(hi_tbl,
+                        _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi),
+                                         _mm256_setzero_si256());
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(miss);
+        if (mask != 0) return iter + __builtin_ctz(mask);
+        iter += 32;
+    }
+    return findBreakSSE2(iter, end);
+}
+#endif
+
+// (4) entry points, dispatch on the selected level
+//
+// Most runs are a handful of bytes. A scalar loop whose exit is predicted
+// speculates straight through those, while a vector compare puts its full
+// latency on the critical path, so only runs that outlast a short scalar
+// probe are handed to the vector code.
+constexpr long SCALAR_PROBE = 16;
+
+// First character in [iter, end) that is not a space or tab
+inline const char* skipBlanks(const char* iter, const char* end)
+{
+    auto probe_end = (end - iter > SCALAR_PROBE) ? iter + SCALAR_PROBE : end;
+    iter = skipBlanksScalar(iter, probe_end);
+    if (iter != probe_end || iter == end) return iter;
+
+#ifdef LEXER_SIMD_X86
+    switch (level)
+    {
+        case Level::AVX2: return skipBlanksAVX2(iter, end);
+        case Level::SSE2: return skipBlanksSSE2(iter, end);
+        default: break;
+    }
+#endif
+    return skipBlanksScalar(iter, end);
+}
+
+// First character in [iter, end) that ends an identifier or number run
+inline const char* findBreak(const char* iter, const char* end)
+{
+    auto probe_end = (end - iter > SCALAR_PROBE) ? iter + SCALAR_PROBE : end;
+    iter = findBreakScalar(iter, probe_end);
+    if (iter != probe_end || iter == end) return iter;
+
+#ifdef LEXER_SIMD_X86
+    switch (level)
+    {
+        case Level::AVX2: return findBreakAVX2(iter, end);
+        case Level::SSE2: return findBreakSSE2(iter, end);
+        default: break;
+    }
+#endif
+    return findBreakScalar(iter, end);
+}
+}
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef __SOURCE_HH__
+#define __SOURCE_HH__
+
+#include "lexer/space.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Frontend
+{
+/*
+ * Read-only memory mapping of a whole source file.
+ *
+ * Tokens produced from the mapping are plain views (pointer + length), so
+ * the buffer must outlive every token, identifier and AST node that still
+ * references it. The Lexer owns the buffer and the Parser owns the Lexer.
+ *
+ * The file is mapped into the FixedSpace, so the views in an AST point
+ * to the same addresses in every process that maps the same file first.
+ * */
+class SourceBuffer
+{
+  protected:
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+
+  public:
+    SourceBuffer() {}
+
+    SourceBuffer(const char* fn) { open(fn); }
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    ~SourceBuffer() { close(); }
+
+    void open(const char* fn)
+    {
+        close();
+
+        int fd = ::open(fn, O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "[Error] SourceBuffer: cannot open "
+                      << fn << "\n";
+            exit(0);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            std::cerr << "[Error] SourceBuffer: cannot stat "
+                      << fn << "\n";
+            ::close(fd);
+            exit(0);
+        }
+
+        size = st.st_size;
+        // mmap() rejects zero-length mappings, an empty file is
+        // simply an empty view.
+        if (size != 0)
+        {
+            void *addr = FixedSpace::map(size, PROT_READ, fd);
+            if (addr == nullptr)
+            {
+                std::cerr << "[Error] SourceBuffer: cannot map "
+                          << fn << "\n";
+                ::close(fd);
+                exit(0);
+            }
+            // The lexer walks the file front to back exactly once
+            madvise(addr, size, MADV_SEQUENTIAL);
+
+            data = static_cast<const char*>(addr);
+            mapped = true;
+        }
+        ::close(fd);
+    }
+
+    void close()
+    {
+        if (mapped) FixedSpace::unmap(const_cast<char*>(data), size);
+
+        data = nullptr;
+        size = 0;
+        mapped = false;
+    }
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+    size_t length() const { return size; }
+
+    std::string_view view() const { return std::string_view(data, size); }
+};
+
+/*
+ * Byte offset to line/column translation for diagnostics.
+ *
+ * Tokens only remember their byte offset. The table of line starts is
+ * built on the first query, so a clean compile never pays for it.
+ * */
+class LineTable
+{
+  public:
+    // Both 1-based, the column counts bytes
+    struct Location
+    {
+        uint32_t line = 0;
+        uint32_t col = 0;
+    };
+
+  protected:
+    std::string_view text;
+
+    // offset of the first byte of every line, empty until the first query
+    std::vector<uint32_t> starts;
+
+  public:
+    void reset(std::string_view _text)
+    {
+        text = _text;
+        starts.clear();
+    }
+
+    Location locate(uint32_t offset)
+    {
+        build();
+
+        auto iter = std::upper_bound(starts.begin(), starts.end(), offset);
+        uint32_t line_idx = (iter - starts.begin()) - 1;
+
+        Location loc;
+        loc.line = line_idx + 1;
+        loc.col = offset - starts[line_idx] + 1;
+        return loc;
+    }
+
+    // Text of a 1-based line without its '\n'
+    std::string_view lineText(uint32_t line)
+    {
+        build();
+        if (line == 0 || line > starts.size()) return std::string_view();
+
+        uint32_t begin = starts[line - 1];
+        uint32_t end = (line < starts.size()) ? starts[line] - 1 : 
+                                                text.size();
+        return text.substr(begin, end - begin);
+    }
+
+  protected:
+    void build()
+    {
+        if (!starts.empty()) return;
+
+        starts.push_back(0);
+        auto iter = text.data();
+        auto end = text.data() + text.size();
+        while (auto nl = static_cast<const char*>(
+                             memchr(iter, '\n', end - iter)))
+        {
+            iter = nl + 1;
+            starts.push_back(iter - text.data());
+        }
+    }
+};
+}
+
+#endif
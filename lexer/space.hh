@@ -0,0 +1,97 @@
+#ifndef __SPACE_HH__
+#define __SPACE_HH__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Linux 4.17+, older glibc headers lack the flag (older kernels ignore
+// it and treat the address as a hint, which map() checks for)
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+namespace Frontend
+{
+/*
+ * Fixed range of virtual addresses for everything an AST points into -
+ * the source mapping and the arena blocks.
+ *
+ * Mappings are handed out front to back from the same base address in
+ * every process, so a parsed program written out byte for byte (see
+ * parser/cache.hh) can later be mapped back at the addresses it was built
+ * at, where all of its pointers are valid as they are.
+ *
+ * Should part of the range be in use, mappings go wherever mmap() puts
+ * them and the space is marked broken. Everything still works, only
+ * nothing gets cached.
+ * */
+class FixedSpace
+{
+  protected:
+    static constexpr uintptr_t BASE = 0x3c0000000000ull;
+    static constexpr uintptr_t LIMIT = BASE + (1ull << 40);
+
+    // Next free address, bumped by every mapping
+    static inline std::atomic<uintptr_t> next{BASE};
+    static inline std::atomic<bool> broken{false};
+
+  public:
+    static size_t pageAlign(size_t size)
+    {
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        return (size + page - 1) & ~(page - 1);
+    }
+
+    // size bytes (whole pages) of fd from offset 0, or of anonymous
+    // zeroed memory if fd < 0. nullptr if mmap() fails altogether.
+    static void* map(size_t size, int prot, int fd = -1)
+    {
+        size = pageAlign(size);
+        int flags = MAP_PRIVATE | ((fd < 0) ? MAP_ANONYMOUS : 0);
+
+        auto addr = next.fetch_add(size);
+        if (addr + size <= LIMIT)
+        {
+            void *ptr = mmap((void*)addr, size, prot,
+                             flags | MAP_FIXED_NOREPLACE, fd, 0);
+            if (ptr == (void*)addr) return ptr;
+            if (ptr != MAP_FAILED) munmap(ptr, size);
+        }
+
+        broken = true;
+        void *ptr = mmap(nullptr, size, prot, flags, fd, 0);
+        return (ptr == MAP_FAILED) ? nullptr : ptr;
+    }
+
+    // size bytes of fd from offset exactly at addr, false if any of it is
+    // in use. Later map()s stay clear of the range.
+    static bool mapAt(void *addr, size_t size, int prot, int fd, off_t offset)
+    {
+        size = pageAlign(size);
+
+        void *ptr = mmap(addr, size, prot,
+                         MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd, offset);
+        if (ptr != addr)
+        {
+            if (ptr != MAP_FAILED) munmap(ptr, size);
+            return false;
+        }
+
+        auto end = (uintptr_t)addr + size;
+        auto cur = next.load();
+        while (cur < end && !next.compare_exchange_weak(cur, end)) {}
+        return true;
+    }
+
+    static void unmap(void *addr, size_t size) { munmap(addr, pageAlign(size)); }
+
+    // Whether every mapping so far got its fixed address
+    static bool intact() { return !broken; }
+};
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __SYMBOLS_HH__
+#define __SYMBOLS_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace Frontend
+{
+// Dense identifier ID, 0 .. SymbolTable::size() - 1
+using Symbol = uint32_t;
+constexpr Symbol NO_SYMBOL = ~Symbol(0);
+
+/*
+ * Identifier interner.
+ *
+ * The lexer hands every distinct identifier a dense 32-bit ID the first
+ * time it sees it, so the parser and codegen tables can be keyed by an
+ * integer instead of rehashing names. Names are stored as views, so the
+ * text they point into (the source buffer, or a string literal for the
+ * built-ins) must outlive the table - the Lexer owns both.
+ *
+ * Open addressing with linear probing; each slot keeps the full hash next
+ * to the ID so a probe only touches the name on a likely match.
+ * */
+class SymbolTable
+{
+  protected:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        Symbol sym = NO_SYMBOL;
+    };
+
+    std::vector<std::string_view> names;
+    std::vector<Slot> slots = std::vector<Slot>(256);
+
+    template <typename T>
+    static uint64_t load(const char* ptr)
+    {
+        T val;
+        memcpy(&val, ptr, sizeof(T));
+        return val;
+    }
+
+    static uint64_t mix(uint64_t hash, uint64_t word)
+    {
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        return hash ^ (hash >> 32);
+    }
+
+    static uint32_t hashName(std::string_view name)
+    {
+        // Whole words only, with overlapping loads for the tail, so no
+        // load has a variable length (those end up as memcpy calls)
+        auto ptr = name.data();
+        auto len = name.size();
+        uint64_t hash = len * 0x9e3779b97f4a7c15ull;
+
+        if (len >= 8)
+        {
+            for (size_t i = 0; i + 8 < len; i += 8)
+                hash = mix(hash, load<uint64_t>(ptr + i));
+            hash = mix(hash, load<uint64_t>(ptr + len - 8));
+        }
+        else if (len >= 4)
+        {
+            hash = mix(hash, load<uint32_t>(ptr) |
+                             (load<uint32_t>(ptr + len - 4) << 32));
+        }
+        else if (len > 0)
+        {
+            hash = mix(hash, (uint8_t)ptr[0] | 
+                             ((uint8_t)ptr[len / 2] << 8) |
+                             ((uint8_t)ptr[len - 1] << 16));
+        }
+
+        // the slot index takes the low bits, fold the high ones in
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        return (uint32_t)(hash >> 32);
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+
+        auto mask = slots.size() - 1;
+        for (auto &slot : old)
+        {
+            if (slot.sym == NO_SYMBOL) continue;
+
+            auto idx = slot.hash & mask;
+            while (slots[idx].sym != NO_SYMBOL) idx = (idx + 1) & mask;
+            slots[idx] = slot;
+        }
+    }
+
+  public:
+    // ID of name, a new one if name was never seen
+    Symbol intern(std::string_view name)
+    {
+        auto hash = hashName(name);
+        auto mask = slots.size() - 1;
+        auto idx = hash & mask;
+        while (slots[idx].sym != NO_SYMBOL)
+        {
+            if (slots[idx].hash == hash && names[slots[idx].sym] == name)
+                return slots[idx].sym;
+            idx = (idx + 1) & mask;
+        }
+
+        Symbol sym = names.size();
+        names.push_back(name);
+        slots[idx] = Slot{hash, sym};
+
+        // keep the load factor under 1/2
+        if (names.size() * 2 > slots.size()) grow();
+        return sym;
+    }
+
+    // ID of name, NO_SYMBOL if name was never interned
+    Symbol find(std::string_view name) const
+    {
+        auto hash = hashName(name);
+        auto mask = slots.size() - 1;
+        auto idx = hash & mask;
+        while (slots[idx].sym != NO_SYMBOL)
+        {
+            if (slots[idx].hash == hash && names[slots[idx].sym] == name)
+                return slots[idx].sym;
+            idx = (idx + 1) & mask;
+        }
+        return NO_SYMBOL;
+    }
+
+    std::string_view name(Symbol sym) const { return names[sym]; }
+
+    size_t size() const { return names.size(); }
+};
+}
+
+#endif
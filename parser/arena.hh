@@ -0,0 +1,253 @@
+#ifndef __ARENA_HH__
+#define __ARENA_HH__
+
+#include "lexer/space.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Frontend
+{
+/*
+ * Fixed-size array inside an Arena (pointer + count), the arena spelling
+ * of a node's child list. Read-only once built.
+ * */
+template <typename T>
+class ArenaSpan
+{
+  protected:
+    T *elems = nullptr;
+    uint32_t num_elems = 0;
+
+  public:
+    ArenaSpan() {}
+    ArenaSpan(T *_elems, uint32_t _num_elems)
+        : elems(_elems)
+        , num_elems(_num_elems)
+    {}
+
+    T* begin() const { return elems; }
+    T* end() const { return elems + num_elems; }
+    size_t size() const { return num_elems; }
+    bool empty() const { return num_elems == 0; }
+
+    T& operator[](size_t idx) const { return elems[idx]; }
+    T& back() const { return elems[num_elems - 1]; }
+};
+
+/*
+ * Bump-pointer arena for AST nodes.
+ *
+ * Nodes are carved out of large blocks back to back and reference each
+ * other by raw pointer; nothing is freed until the arena goes away, then
+ * all blocks are released at once. Nodes that own heap memory of their
+ * own get their destructor recorded and run first; plain nodes cost
+ * nothing to free. (The AST has none of the former, which is what lets it
+ * be cached.)
+ *
+ * Nodes never move, so pointers into the arena stay valid for as long as
+ * the arena (owned by Program) lives. Blocks come from the FixedSpace,
+ * which is what lets the AST cache save them and map them back in place.
+ * */
+class Arena
+{
+  public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Block
+    {
+        char *data;
+        size_t size;
+        // bytes handed out, up to the end of the last allocation
+        size_t used;
+    };
+
+  protected:
+    std::vector<Block> blocks;
+    char *cur = nullptr;
+    char *end = nullptr;
+    // index of the block cur points into
+    size_t cur_block = 0;
+
+    struct Dtor
+    {
+        void *obj;
+        void (*destroy)(void*);
+    };
+    std::vector<Dtor> dtors;
+
+    size_t num_nodes = 0;
+    size_t node_bytes = 0;
+    size_t span_bytes = 0;
+    size_t block_bytes = 0;
+
+    void* allocate(size_t size, size_t align)
+    {
+        auto ptr = alignUp(cur, align);
+        if (ptr == nullptr || ptr + size > end)
+        {
+            retire();
+
+            // Oversized nodes get a block of their own
+            auto block_size = FixedSpace::pageAlign(
+                                  std::max(BLOCK_SIZE, size + align));
+            auto data = static_cast<char*>(
+                FixedSpace::map(block_size, PROT_READ | PROT_WRITE));
+            if (data == nullptr)
+            {
+                std::cerr << "[Error] out of memory for the AST\n";
+                exit(0);
+            }
+
+            blocks.push_back(Block{data, block_size, 0});
+            block_bytes += block_size;
+            cur_block = blocks.size() - 1;
+
+            cur = data;
+            end = cur + block_size;
+            ptr = alignUp(cur, align);
+        }
+        cur = ptr + size;
+        return ptr;
+    }
+
+    // Done with the current block, record how much of it is in use
+    void retire()
+    {
+        if (cur != nullptr) blocks[cur_block].used = cur - blocks[cur_block].data;
+        cur = end = nullptr;
+    }
+
+    static char* alignUp(char *ptr, size_t align)
+    {
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        addr = (addr + align - 1) & ~(uintptr_t)(align - 1);
+        return reinterpret_cast<char*>(addr);
+    }
+
+  public:
+    Arena() {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena()
+    {
+        // Children are created before their parents, tear down in reverse
+        for (auto iter = dtors.rbegin(); iter != dtors.rend(); iter++)
+            iter->destroy(iter->obj);
+
+        for (auto &block : blocks) FixedSpace::unmap(block.data, block.size);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        auto obj = new (allocate(sizeof(T), alignof(T)))
+                       T(std::forward<Args>(args)...);
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            dtors.push_back({obj, [](void *ptr)
+                                  { static_cast<T*>(ptr)->~T(); }});
+
+        num_nodes++;
+        node_bytes += sizeof(T);
+        return obj;
+    }
+
+    // Copy of a child list built up in a vector during parsing
+    template <typename T>
+    ArenaSpan<T> copy(const std::vector<T> &elems)
+    {
+        static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_destructible_v<T>,
+                      "span elements are copied bytewise and never destroyed");
+        if (elems.empty()) return ArenaSpan<T>();
+
+        auto bytes = sizeof(T) * elems.size();
+        auto ptr = static_cast<T*>(allocate(bytes, alignof(T)));
+        std::copy(elems.begin(), elems.end(), ptr);
+
+        span_bytes += bytes;
+        return ArenaSpan<T>(ptr, elems.size());
+    }
+
+    // Copy of a piece of text that does not live in the source buffer
+    std::string_view copy(std::string_view text)
+    {
+        auto ptr = static_cast<char*>(allocate(text.size(), 1));
+        memcpy(ptr, text.data(), text.size());
+
+        span_bytes += text.size();
+        return std::string_view(ptr, text.size());
+    }
+
+    // Take over all of other's blocks, along with the destructors of the
+    // nodes in them. Nothing moves, pointers into other stay valid; other
+    // is left empty.
+    void absorb(Arena &other)
+    {
+        other.retire();
+
+        blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+        dtors.insert(dtors.end(), other.dtors.begin(), other.dtors.end());
+
+        num_nodes += other.num_nodes;
+        node_bytes += other.node_bytes;
+        span_bytes += other.span_bytes;
+        block_bytes += other.block_bytes;
+
+        other.blocks.clear();
+        other.dtors.clear();
+        other.num_nodes = other.node_bytes = 0;
+        other.span_bytes = other.block_bytes = 0;
+    }
+
+    // Blocks with their current fill, in address order (for saving)
+    std::vector<Block> usedBlocks()
+    {
+        auto saved_cur = cur, saved_end = end;
+        retire();
+        cur = saved_cur, end = saved_end;
+
+        auto sorted = blocks;
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const Block &a, const Block &b) { return a.data < b.data; });
+        return sorted;
+    }
+
+    // Blocks mapped in from elsewhere (a cache entry) holding num_nodes
+    // nodes, freed along with the arena's own blocks
+    void adopt(const std::vector<Block> &_blocks, size_t _num_nodes,
+               size_t _node_bytes, size_t _span_bytes)
+    {
+        for (auto &block : _blocks)
+        {
+            blocks.push_back(block);
+            block_bytes += block.size;
+        }
+
+        num_nodes += _num_nodes;
+        node_bytes += _node_bytes;
+        span_bytes += _span_bytes;
+    }
+
+    // Stats
+    size_t numNodes() const { return num_nodes; }
+    size_t nodeBytes() const { return node_bytes; }
+    size_t spanBytes() const { return span_bytes; }
+    size_t blockBytes() const { return block_bytes; }
+    size_t numDtors() const { return dtors.size(); }
+};
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "parser/cache.hh"
+#include "parser/parser.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Frontend
+{
+static constexpr char MAGIC[8] = {'A', 'S', 'T', 'C', 'A', 'C', 'H', 'E'};
+
+// Checksum of the headers that declare the AST, passed in by the makefile
+#ifndef AST_LAYOUT
+#define AST_LAYOUT "unknown"
+#endif
+
+// Name, size and alignment of T
+template <typename T>
+static std::string layoutOf()
+{
+    return std::string(__PRETTY_FUNCTION__) + " " +
+           std::to_string(sizeof(T)) + " " + std::to_string(alignof(T));
+}
+
+// Every alternative of a node variant by index, so that adding, removing
+// or reordering a kind changes it
+template <typename Variant, size_t... I>
+static std::string variantLayout(std::index_sequence<I...>)
+{
+    std::string sig;
+    ((sig += " " + std::to_string(I) + ": " +
+             layoutOf<std::variant_alternative_t<I, Variant>>()), ...);
+    return sig;
+}
+
+template <typename Variant>
+static std::string variantLayout()
+{
+    return variantLayout<Variant>(
+        std::make_index_sequence<std::variant_size_v<Variant>>());
+}
+
+ASTCache::ASTCache(const char* _dir, std::string_view source,
+                   std::string_view options)
+    : dir(_dir)
+{
+    mkdir(dir.c_str(), 0755);
+
+    // The format - version, compiler, AST headers and node layout
+    std::string format = "ast-cache " + std::to_string(FORMAT_VERSION) +
+                         " " + __VERSION__ +
+                         " " + AST_LAYOUT +
+                         " " + layoutOf<Token>() +
+                         " " + std::to_string(offsetof(Token, type)) +
+                         " " + std::to_string(offsetof(Token, literal)) +
+                         " " + std::to_string(offsetof(Token, offset)) +
+                         " " + std::to_string(offsetof(Token, value)) +
+                         " " + layoutOf<LocalSlot>() +
+                         " " + std::to_string(offsetof(LocalSlot, sym)) +
+                         " " + std::to_string(offsetof(LocalSlot, type)) +
+                         " " + layoutOf<Expression>() +
+                         variantLayout<Expression::Node>() +
+                         " " + layoutOf<Statement>() +
+                         variantLayout<Statement::Node>() +
+                         " " + layoutOf<Condition>() +
+                         " " + layoutOf<FuncStatement::Argument>() +
+                         " " + std::string(options);
+
+    key = hash(source, hash(format, 0));
+}
+
+std::string ASTCache::entryPath() const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.ast", (unsigned long long)key);
+    return dir + name;
+}
+
+// Four independent lanes so the multiplies overlap
+uint64_t ASTCache::hash(std::string_view text, uint64_t seed)
+{
+    auto mix = [](uint64_t hash, uint64_t word)
+    {
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        return hash ^ (hash >> 32);
+    };
+
+    uint64_t lanes[4] = {seed, seed + 1, seed + 2, seed + 3};
+    auto ptr = text.data();
+    auto len = text.size();
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, ptr + i + lane * 8, 8);
+            lanes[lane] = mix(lanes[lane], word);
+        }
+    }
+    for (; i < len; i += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, ptr + i, std::min<size_t>(8, len - i));
+        lanes[0] = mix(lanes[0], word);
+    }
+
+    uint64_t hash = len;
+    for (auto lane : lanes) hash = mix(hash, lane);
+    return hash;
+}
+
+bool ASTCache::load(std::string_view source, Arena &arena, Entry &entry)
+{
+    auto start = std::chrono::steady_clock::now();
+    hit = tryLoad(source, arena, entry);
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+    load_secs = secs.count();
+
+    count(hit);
+    return hit;
+}
+
+bool ASTCache::tryLoad(std::string_view source, Arena &arena, Entry &entry)
+{
+    int fd = open(entryPath().c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    Header header;
+    bool ok = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+              memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              header.key == key &&
+              header.source_size == source.size() &&
+              header.source_addr == (uint64_t)source.data();
+
+    std::vector<Segment> segs;
+    if (ok)
+    {
+        segs.resize(header.num_segments);
+        auto bytes = sizeof(Segment) * segs.size();
+        ok = pread(fd, segs.data(), bytes, sizeof(header)) == (ssize_t)bytes;
+    }
+
+    // Every segment goes back to its own address or the entry is no use
+    std::vector<Arena::Block> blocks;
+    for (size_t i = 0; ok && i < segs.size(); i++)
+    {
+        auto &seg = segs[i];
+        ok = FixedSpace::mapAt((void*)seg.addr, seg.size,
+                               PROT_READ | PROT_WRITE, fd, seg.offset);
+        if (ok) blocks.push_back({(char*)seg.addr, seg.size, seg.size});
+    }
+    close(fd);
+
+    if (!ok)
+    {
+        for (auto &block : blocks) FixedSpace::unmap(block.data, block.size);
+        return false;
+    }
+
+    arena.adopt(blocks, header.num_nodes, header.node_bytes,
+                header.span_bytes);
+    entry = header.entry;
+    return true;
+}
+
+void ASTCache::store(std::string_view source, Arena &arena, const Entry &entry)
+{
+    if (!FixedSpace::intact() || arena.numDtors() != 0) return;
+
+    // Neighbouring blocks that are used up to their last page form one
+    // segment
+    std::vector<Segment> segs;
+    for (auto &block : arena.usedBlocks())
+    {
+        if (block.used == 0) continue;
+
+        auto addr = (uint64_t)block.data;
+        auto size = FixedSpace::pageAlign(block.used);
+        if (!segs.empty() && segs.back().addr + segs.back().size == addr)
+            segs.back().size += size;
+        else
+            segs.push_back({addr, size, 0});
+    }
+
+    uint64_t offset = FixedSpace::pageAlign(sizeof(Header) +
+                                            sizeof(Segment) * segs.size());
+    for (auto &seg : segs)
+    {
+        seg.offset = offset;
+        offset += seg.size;
+    }
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.key = key;
+    header.source_addr = (uint64_t)source.data();
+    header.source_size = source.size();
+    header.entry = entry;
+    header.num_nodes = arena.numNodes();
+    header.node_bytes = arena.nodeBytes();
+    header.span_bytes = arena.spanBytes();
+    header.num_segments = segs.size();
+
+    // Write aside and rename, a reader never sees half an entry
+    auto path = entryPath();
+    auto tmp = path + "." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+
+    bool ok = pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    auto bytes = sizeof(Segment) * segs.size();
+    ok = ok && pwrite(fd, segs.data(), bytes, sizeof(header)) == (ssize_t)bytes;
+    for (auto &seg : segs)
+    {
+        ok = ok && pwrite(fd, (void*)seg.addr, seg.size, seg.offset) ==
+                   (ssize_t)seg.size;
+    }
+    close(fd);
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) unlink(tmp.c_str());
+}
+
+void ASTCache::count(bool _hit)
+{
+    auto path = dir + "/stats";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+
+    // Concurrent runs take turns
+    flock(fd, LOCK_EX);
+
+    char buf[128] = {0};
+    unsigned long long hits = 0, misses = 0;
+    if (pread(fd, buf, sizeof(buf) - 1, 0) > 0)
+        sscanf(buf, "hits %llu misses %llu", &hits, &misses);
+
+    if (_hit) hits++;
+    else misses++;
+    counters.hits = hits;
+    counters.misses = misses;
+
+    auto len = snprintf(buf, sizeof(buf), "hits %llu misses %llu\n",
+                        hits, misses);
+    if (ftruncate(fd, 0) == 0) pwrite(fd, buf, len, 0);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+}
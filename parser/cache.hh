@@ -0,0 +1,113 @@
+#ifndef __CACHE_HH__
+#define __CACHE_HH__
+
+#include "parser/arena.hh"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Frontend
+{
+class Statement;
+
+/*
+ * On-disk cache of parsed programs.
+ *
+ * An entry is the arena of a Program written out byte for byte. Arena
+ * blocks and the source mapping sit at fixed addresses (lexer/space.hh),
+ * so loading an entry is a handful of mmap() calls that put every block
+ * back where it was when the entry was written. The pointers inside are
+ * used as they are, nothing is decoded or fixed up, and pages are only
+ * read in once the tree is walked.
+ *
+ * Entries are keyed by a hash of the source text, of the AST format and
+ * of the parser options that shape the tree, so an edit to the source or
+ * a build with a different node layout misses. The format is
+ * FORMAT_VERSION, the compiler, a checksum of the AST headers taken at
+ * build time, the size and alignment of the nodes and of every variant
+ * alternative in order, and the member offsets of Token and LocalSlot.
+ * Entries live in <dir>/<key>.ast, the hit and miss counts of every run
+ * in <dir>/stats.
+ * */
+class ASTCache
+{
+  public:
+    // When to bump: see the node definitions in parser/parser.hh
+    static constexpr unsigned FORMAT_VERSION = 2;
+
+    // Roots of a cached program, every other node hangs off them
+    struct Entry
+    {
+        ArenaSpan<Statement*> statements;
+        // symbol names by ID
+        ArenaSpan<std::string_view> names;
+    };
+
+    // Totals over every run using the same directory
+    struct Counters
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+  protected:
+    struct Header
+    {
+        char magic[8];
+        uint64_t key;
+
+        // where the source was mapped and how long it was
+        uint64_t source_addr;
+        uint64_t source_size;
+
+        Entry entry;
+
+        // arena stats, for --stats
+        uint64_t num_nodes;
+        uint64_t node_bytes;
+        uint64_t span_bytes;
+
+        uint64_t num_segments;
+    };
+
+    // A run of arena pages, stored at a page-aligned file offset
+    struct Segment
+    {
+        uint64_t addr;
+        uint64_t size;
+        uint64_t offset;
+    };
+
+    std::string dir;
+    uint64_t key = 0;
+
+    bool hit = false;
+    double load_secs = 0;
+    Counters counters;
+
+    std::string entryPath() const;
+    bool tryLoad(std::string_view source, Arena &arena, Entry &entry);
+    void count(bool _hit);
+
+  public:
+    // options - parser options the tree depends on, part of the key
+    ASTCache(const char* _dir, std::string_view source,
+             std::string_view options = "");
+
+    // Map the entry for source into arena, false on a miss
+    bool load(std::string_view source, Arena &arena, Entry &entry);
+
+    // Save arena as the entry for source. Skipped if any block is not at
+    // its fixed address or the arena holds nodes with destructors.
+    void store(std::string_view source, Arena &arena, const Entry &entry);
+
+    static uint64_t hash(std::string_view text, uint64_t seed);
+
+    bool isHit() const { return hit; }
+    double loadSecs() const { return load_secs; }
+    Counters getCounters() const { return counters; }
+};
+}
+
+#endif
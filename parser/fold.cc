@@ -0,0 +1,285 @@
+#include "parser/fold.hh"
+
+#include <charconv>
+#include <climits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Frontend
+{
+void ASTFolder::foldProgram()
+{
+    for (auto statement : program.getStatements()) foldStatement(statement);
+}
+
+// Order does not matter, the statements under root are simply all
+// visited, off a stack
+void ASTFolder::foldStatement(Statement *root)
+{
+    std::vector<Statement*> pending{root};
+    auto pushBlock = [&](ArenaSpan<Statement*> block)
+    {
+        pending.insert(pending.end(), block.begin(), block.end());
+    };
+
+    while (!pending.empty())
+    {
+        auto statement = pending.back();
+        pending.pop_back();
+
+        statement->visit(Overloaded{
+            [&](FuncStatement &func) { pushBlock(func.getFuncCodes()); },
+            [&](AssnStatement &assn)
+            {
+                // the target may be an indexed element, fold the index
+                fold(assn.getIden());
+                fold(assn.getExpr());
+            },
+            [&](RetStatement &ret) { fold(ret.getRetVal()); },
+            [&](CallStatement &call) { fold(call.getExpr()); },
+            [&](IfStatement &if_s)
+            {
+                foldCond(if_s.getCond());
+                pushBlock(if_s.getTakenBlock());
+                pushBlock(if_s.getNotTakenBlock());
+            },
+            [&](ForStatement &for_s)
+            {
+                pending.push_back(for_s.getStart());
+                foldCond(for_s.getEnd());
+                pending.push_back(for_s.getStep());
+                pushBlock(for_s.getBlock());
+            },
+            [&](WhileStatement &while_s)
+            {
+                foldCond(while_s.getEnd());
+                pushBlock(while_s.getBlock());
+            }
+        });
+    }
+}
+
+void ASTFolder::foldCond(Condition *cond)
+{
+    fold(cond->getLeft());
+    fold(cond->getRight());
+}
+
+// Bottom up - an expression is folded once everything under it is. Each
+// entry of the stack is an expression and whether its operands are done.
+Expression* ASTFolder::fold(Expression *root)
+{
+    if (root == nullptr) return root;
+
+    std::vector<std::pair<Expression*,bool>> pending{{root, false}};
+    while (!pending.empty())
+    {
+        auto [expr, operands_done] = pending.back();
+        pending.pop_back();
+
+        if (operands_done)
+        {
+            foldNode(expr);
+            continue;
+        }
+
+        pending.push_back({expr, true});
+        auto push = [&](Expression *operand)
+                    { pending.push_back({operand, false}); };
+        expr->visit(Overloaded{
+            [&](LiteralExpression&) {},
+            [&](ArithExpression &arith)
+            {
+                push(arith.getLeft());
+                push(arith.getRight());
+            },
+            [&](ArrayExpression &array)
+            {
+                push(array.getNumElements());
+                for (auto ele : array.getElements()) push(ele);
+            },
+            [&](IndexExpression &index) { push(index.getIndex()); },
+            [&](CallExpression &call) { for (auto arg : call.getArgs()) push(arg); }
+        });
+    }
+    return root;
+}
+
+// The operands are folded already
+void ASTFolder::foldNode(Expression *expr)
+{
+    auto arith = expr->as<ArithExpression>();
+    if (arith == nullptr) return;
+
+    auto opr = arith->getType();
+    auto left = arith->getLeft();
+    auto right = arith->getRight();
+
+    if (isNumber(left) && isNumber(right) &&
+        foldLiterals(expr, opr, left->as<LiteralExpression>(),
+                     right->as<LiteralExpression>()))
+    {
+        stats.folded++;
+    }
+    else if (simplify(expr, opr, left, right))
+    {
+        stats.simplified++;
+    }
+}
+
+bool ASTFolder::foldLiterals(Expression *expr, ExpressionType opr,
+                                  LiteralExpression *left,
+                                  LiteralExpression *right)
+{
+    if (left->isLiteralInt() && right->isLiteralInt())
+    {
+        // Unsigned so overflow wraps instead of being undefined
+        uint32_t lhs = left->getInt();
+        uint32_t rhs = right->getInt();
+        switch (opr)
+        {
+            case ExpressionType::PLUS:
+                makeInt(expr, (int32_t)(lhs + rhs));
+                return true;
+            case ExpressionType::MINUS:
+                makeInt(expr, (int32_t)(lhs - rhs));
+                return true;
+            case ExpressionType::ASTERISK:
+                makeInt(expr, (int32_t)(lhs * rhs));
+                return true;
+            case ExpressionType::SLASH:
+                // sdiv traps (or worse) on these, keep them for run time
+                if (right->getInt() == 0 ||
+                    (left->getInt() == INT_MIN && right->getInt() == -1))
+                {
+                    return false;
+                }
+                makeInt(expr, left->getInt() / right->getInt());
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    if (left->isLiteralFloat() && right->isLiteralFloat())
+    {
+        float lhs = left->getFloat();
+        float rhs = right->getFloat();
+        switch (opr)
+        {
+            case ExpressionType::PLUS:
+                makeFloat(expr, lhs + rhs);
+                return true;
+            case ExpressionType::MINUS:
+                makeFloat(expr, lhs - rhs);
+                return true;
+            case ExpressionType::ASTERISK:
+                makeFloat(expr, lhs * rhs);
+                return true;
+            case ExpressionType::SLASH:
+                makeFloat(expr, lhs / rhs);
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool ASTFolder::simplify(Expression *expr, ExpressionType opr,
+                              Expression *left, Expression *right)
+{
+    Expression *keep = nullptr;
+    switch (opr)
+    {
+        case ExpressionType::PLUS:
+            if (isIntValue(right, 0)) keep = left;
+            else if (isIntValue(left, 0)) keep = right;
+            break;
+        case ExpressionType::MINUS:
+            if (isIntValue(right, 0)) keep = left;
+            break;
+        case ExpressionType::ASTERISK:
+            if (isIntValue(right, 1)) keep = left;
+            else if (isIntValue(left, 1)) keep = right;
+            else if (isIntValue(right, 0) && !hasCall(left)) keep = right;
+            else if (isIntValue(left, 0) && !hasCall(right)) keep = left;
+            break;
+        case ExpressionType::SLASH:
+            if (isIntValue(right, 1)) keep = left;
+            break;
+        default:
+            break;
+    }
+    if (keep == nullptr) return false;
+
+    // Copy first, keep may be the only thing holding the node
+    Expression kept = *keep;
+    *expr = kept;
+    return true;
+}
+
+void ASTFolder::makeInt(Expression *expr, int32_t val)
+{
+    auto text = program.getArena().copy(std::to_string(val));
+    Token tok(Token::TokenType::TOKEN_INT, text);
+    tok.value.i = val;
+    *expr = Expression(std::in_place_type<LiteralExpression>, tok);
+}
+
+void ASTFolder::makeFloat(Expression *expr, float val)
+{
+    // Shortest text that reads back as val, spelled as a float
+    char buf[32];
+    auto end = std::to_chars(buf, buf + sizeof(buf), val).ptr;
+    std::string text(buf, end);
+    if (text.find_first_of(".en") == std::string::npos) text += ".0";
+
+    Token tok(Token::TokenType::TOKEN_FLOAT,
+              program.getArena().copy(text));
+    tok.value.f = val;
+    *expr = Expression(std::in_place_type<LiteralExpression>, tok);
+}
+
+bool ASTFolder::isNumber(Expression *expr)
+{
+    auto lit = expr->as<LiteralExpression>();
+    return lit != nullptr && (lit->isLiteralInt() || lit->isLiteralFloat());
+}
+
+bool ASTFolder::isIntValue(Expression *expr, int32_t val)
+{
+    auto lit = expr->as<LiteralExpression>();
+    return lit != nullptr && lit->isLiteralInt() && lit->getInt() == val;
+}
+
+bool ASTFolder::hasCall(Expression *root)
+{
+    std::vector<Expression*> pending{root};
+    while (!pending.empty())
+    {
+        auto expr = pending.back();
+        pending.pop_back();
+
+        bool is_call = expr->visit(Overloaded{
+            [](LiteralExpression&) { return false; },
+            [&](ArithExpression &arith)
+            {
+                pending.push_back(arith.getLeft());
+                pending.push_back(arith.getRight());
+                return false;
+            },
+            [](ArrayExpression&) { return false; },
+            [&](IndexExpression &index)
+            {
+                pending.push_back(index.getIndex());
+                return false;
+            },
+            [](CallExpression&) { return true; }
+        });
+        if (is_call) return true;
+    }
+    return false;
+}
+}
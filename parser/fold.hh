@@ -0,0 +1,74 @@
+#ifndef __FOLD_HH__
+#define __FOLD_HH__
+
+#include "parser/parser.hh"
+
+namespace Frontend
+{
+/*
+ * Constant folding and algebraic simplification, run on the tree between
+ * the parser and codegen.
+ *
+ * - Arithmetic on two number literals becomes one literal. Ints wrap
+ *   around like the i32 instructions codegen would emit; a division by
+ *   zero (or INT_MIN / -1) is left for run time. Floats are computed in
+ *   float, which is what the emitted instructions would do.
+ * - For ints, x + 0, 0 + x, x - 0, x * 1, 1 * x and x / 1 become x, and
+ *   x * 0, 0 * x become 0 when x has no call in it. Floats get none of
+ *   these (-0.0, NaN and infinities break them).
+ *
+ * Expressions are rewritten in place - the Expression object keeps its
+ * address and takes on the folded node - so parents need no updating.
+ * New literal text goes into the program's arena. The parser strictly
+ * types expressions, so the type of a literal operand is the type of the
+ * whole expression.
+ * */
+class ASTFolder
+{
+  public:
+    struct Stats
+    {
+        // operations on two literals turned into one literal
+        size_t folded = 0;
+        // identities applied
+        size_t simplified = 0;
+    };
+
+  protected:
+    Program &program;
+    Stats stats;
+
+    // Both walk with a stack of their own, not by recursion
+    void foldStatement(Statement *root);
+    void foldCond(Condition *cond);
+
+    // Fold expr itself, its operands already are
+    void foldNode(Expression *expr);
+
+    // Both rewrite expr, the ArithExpression it holds, and return whether
+    // they did
+    bool foldLiterals(Expression *expr, ExpressionType opr,
+                      LiteralExpression *left, LiteralExpression *right);
+    bool simplify(Expression *expr, ExpressionType opr,
+                  Expression *left, Expression *right);
+
+    void makeInt(Expression *expr, int32_t val);
+    void makeFloat(Expression *expr, float val);
+
+    static bool isNumber(Expression *expr);
+    static bool isIntValue(Expression *expr, int32_t val);
+    static bool hasCall(Expression *expr);
+
+  public:
+    ASTFolder(Program &_program) : program(_program) {}
+
+    void foldProgram();
+
+    // Fold expr and everything under it, returns expr
+    Expression* fold(Expression *expr);
+
+    Stats getStats() const { return stats; }
+};
+}
+
+#endif
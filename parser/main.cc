@@ -1,14 +1,204 @@
 #include "lexer/lexer.hh"
 #include "parser/parser.hh"
+#include "parser/fold.hh"
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 using namespace Frontend;
 
+// Visits every node once, the traversal --stats times. Nodes wait on two
+// stacks rather than being recursed into.
+struct NodeCounter
+{
+    size_t nodes = 0;
+    std::vector<Expression*> exprs;
+    std::vector<Statement*> statements;
+
+    void push(Expression *expr) { if (expr != nullptr) exprs.push_back(expr); }
+    void push(Condition *cond)
+    {
+        nodes++;
+        push(cond->getLeft());
+        push(cond->getRight());
+    }
+    template <typename T>
+    void push(ArenaSpan<T> &span)
+    {
+        for (auto child : span) push(child);
+    }
+    void push(Statement *statement) { statements.push_back(statement); }
+
+    void count(Statement *root)
+    {
+        push(root);
+        while (!statements.empty() || !exprs.empty())
+        {
+            if (!statements.empty())
+            {
+                auto statement = statements.back();
+                statements.pop_back();
+                nodes++;
+                statement->visit(*this);
+            }
+            else
+            {
+                auto expr = exprs.back();
+                exprs.pop_back();
+                nodes++;
+                expr->visit(*this);
+            }
+        }
+    }
+
+    void operator()(LiteralExpression&) {}
+    void operator()(ArithExpression &arith)
+    {
+        push(arith.getLeft());
+        push(arith.getRight());
+    }
+    void operator()(ArrayExpression &array)
+    {
+        push(array.getNumElements());
+        push(array.getElements());
+    }
+    void operator()(IndexExpression &index) { push(index.getIndex()); }
+    void operator()(CallExpression &call) { push(call.getArgs()); }
+
+    void operator()(FuncStatement &func) { push(func.getFuncCodes()); }
+    void operator()(AssnStatement &assn)
+    {
+        push(assn.getIden());
+        push(assn.getExpr());
+    }
+    void operator()(RetStatement &ret) { push(ret.getRetVal()); }
+    void operator()(CallStatement &call) { (*this)(*call.getCallExpr()); }
+    void operator()(IfStatement &if_s)
+    {
+        push(if_s.getCond());
+        push(if_s.getTakenBlock());
+        push(if_s.getNotTakenBlock());
+    }
+    void operator()(ForStatement &for_s)
+    {
+        push(for_s.getStart());
+        push(for_s.getEnd());
+        push(for_s.getStep());
+        push(for_s.getBlock());
+    }
+    void operator()(WhileStatement &while_s)
+    {
+        push(while_s.getEnd());
+        push(while_s.getBlock());
+    }
+};
+
 int main(int argc, char* argv[])
 {
+    // parser [--pipeline] [--threads N] [--cache DIR] [--share] [--fold]
+    //        [--stats] <source>
+    //   --pipeline  - lex on a separate thread while parsing
+    //   --threads N - lex, then parse function bodies, on N threads
+    //   --cache DIR - take the AST from the cache in DIR, parse and save
+    //                 it there on a miss
+    //   --share     - share equal expressions, the tree becomes a DAG
+    //   --fold      - fold constants (parser/fold.hh) before printing
+    //   --stats     - print parse time and AST allocation stats instead
+    //                 of the tree
+    bool pipelined = false;
+    bool stats = false;
+    bool fold = false;
+    bool share = false;
+    unsigned num_threads = 1;
+    const char* cache_dir = nullptr;
+    const char* fn = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--pipeline") == 0)
+            pipelined = true;
+        else if (strcmp(argv[i], "--stats") == 0)
+            stats = true;
+        else if (strcmp(argv[i], "--share") == 0)
+            share = true;
+        else if (strcmp(argv[i], "--fold") == 0)
+            fold = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            num_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else
+            fn = argv[i];
+    }
+
     // Parser
-    Parser parser(argv[1]);
+    auto parse_start = std::chrono::steady_clock::now();
+    Parser parser(fn, pipelined, num_threads, cache_dir, share);
+    std::chrono::duration<double> parse_secs = 
+        std::chrono::steady_clock::now() - parse_start;
+
+    ASTFolder folder(parser.getProgram());
+    if (fold) folder.foldProgram();
+
+    if (stats)
+    {
+        auto &arena = parser.getProgram().getArena();
+        std::cout << "Parse: " << std::fixed << std::setprecision(1)
+                  << parse_secs.count() * 1e3 << " ms\n"
+                  << "AST nodes: " << arena.numNodes() << "\n"
+                  << "Node bytes: " << arena.nodeBytes() << " ("
+                  << std::fixed << std::setprecision(1)
+                  << (double)arena.nodeBytes() / arena.numNodes()
+                  << " per node)\n"
+                  << "Child lists: " << arena.spanBytes() << " bytes\n"
+                  << "Arena blocks: " << arena.blockBytes() << " bytes\n"
+                  << "Nodes with destructors: " << arena.numDtors() << "\n"
+                  << "sizeof Expression/Statement: " << sizeof(Expression)
+                  << "/" << sizeof(Statement) << "\n";
+
+        if (share)
+            std::cout << "Shared: " << parser.numShared() << " expressions\n";
+
+        if (fold)
+        {
+            auto fold_stats = folder.getStats();
+            std::cout << "Folded: " << fold_stats.folded << " literal ops, "
+                      << fold_stats.simplified << " identities\n";
+        }
+
+        if (auto cache = parser.getCache())
+        {
+            auto counters = cache->getCounters();
+            std::cout << "Cache: " << (cache->isHit() ? "hit" : "miss")
+                      << ", load " << cache->loadSecs() * 1e3 << " ms, "
+                      << counters.hits << " hits " << counters.misses
+                      << " misses in total\n";
+        }
+
+        // Best of a few walks over the whole tree
+        constexpr int WALKS = 5;
+        double best = 0;
+        size_t nodes = 0;
+        for (int walk = 0; walk < WALKS; walk++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            NodeCounter counter;
+            for (auto statement : parser.getProgram().getStatements())
+                counter.count(statement);
+            std::chrono::duration<double> secs = 
+                std::chrono::steady_clock::now() - start;
+
+            nodes = counter.nodes;
+            if (walk == 0 || secs.count() < best) best = secs.count();
+        }
+        std::cout << "Walk: " << nodes << " nodes, " 
+                  << best * 1e9 / nodes << " ns per node\n";
+        return 0;
+    }
+    // The dump is written in one pass, let cout buffer it
+    std::ios::sync_with_stdio(false);
     parser.printStatements();
 }
@@ -1,12 +1,13 @@
 #include "parser/parser.hh"
+#include "parser/fold.hh"
 
 namespace Frontend
 {
-Parser::Parser(const char* fn) : lexer(new Lexer(fn))
+Parser::Parser(const char* fn, bool pipelined, unsigned num_threads,
+               const char* cache_dir, bool _share_exprs)
+    : lexer(new Lexer(fn))
 {
-    // Pre-load all the tokens
-    lexer->getToken(cur_token);
-    lexer->getToken(next_token);
+    share_exprs = _share_exprs;
 
     // Fill the pre-built 
     std::vector<ValueType::Type> arg_types;
@@ -18,7 +19,7 @@ Parser::Parser(const char* fn) : lexer(new Lexer(fn))
     record.ret_type = ret_type;
     record.arg_types = arg_types;
     record.is_built_in = true;
-    func_def_tracker.insert({"printVarInt", record});
+    func_def_tracker->insert({getSymbols().intern("printVarInt"), record});
 
     // printVarFloat
     arg_types.clear();
@@ -26,15 +27,115 @@ Parser::Parser(const char* fn) : lexer(new Lexer(fn))
     record.ret_type = ret_type;
     record.arg_types = arg_types;
     record.is_built_in = true;
-    func_def_tracker.insert({"printVarFloat", record});
+    record.order = 1;
+    func_def_tracker->insert({getSymbols().intern("printVarFloat"), record});
 
-    parseProgram();
+    // Nothing to lex or parse on a hit
+    if (cache_dir != nullptr)
+    {
+        // A shared tree is a different entry
+        cache = std::make_unique<ASTCache>(cache_dir, lexer->getSource(),
+                                           share_exprs ? "shared" : "");
+        if (loadCached()) return;
+    }
+
+    // Built-ins are interned first, the lexer owns the symbol table
+    // while it runs on its own thread
+    if (pipelined)
+    {
+        line_table.reset(lexer->getSource());
+        pipe = std::make_unique<TokenPipe>();
+        pipe->start(*lexer);
+        cur_token = pipe->pop();
+        parseProgram();
+    }
+    else
+    {
+        // Pre-load all the tokens
+        lexer->tokenize(token_buf, num_threads);
+        cur_token = tokens->token(tok_idx);
+
+        if (num_threads > 1)
+            parseProgramParallel(num_threads);
+        else
+            parseProgram();
+    }
+
+    if (cache) storeCached();
+}
+
+// The symbols are interned again in their original order so the IDs in
+// the tree mean the same names; the built-ins already hold the first ones.
+bool Parser::loadCached()
+{
+    ASTCache::Entry entry;
+    if (!cache->load(lexer->getSource(), program.getArena(), entry))
+        return false;
+
+    auto &symbols = getSymbols();
+    for (auto name : entry.names) symbols.intern(name);
+
+    for (auto statement : entry.statements)
+    {
+        auto func = statement->as<FuncStatement>();
+        std::vector<FuncStatement::Argument> args(func->getFuncArgs().begin(),
+                                                  func->getFuncArgs().end());
+        recordDefs(func->getFuncSymbol(), func->getRetType(), args);
+
+        program.addStatement(statement);
+    }
+    return true;
+}
+
+void Parser::storeCached()
+{
+    ASTCache::Entry entry;
+    entry.statements = makeSpan(program.getStatements());
+
+    // Names point into the source mapping, which is back at the same
+    // address on a hit; the built-ins' point into this binary and go in
+    // the image
+    auto source = lexer->getSource();
+    auto &symbols = getSymbols();
+    std::vector<std::string_view> names;
+    for (Symbol sym = 0; sym < symbols.size(); sym++)
+    {
+        auto name = symbols.name(sym);
+        if (name.data() < source.data() ||
+            name.data() + name.size() > source.data() + source.size())
+        {
+            name = program.getArena().copy(name);
+        }
+        names.push_back(name);
+    }
+    entry.names = makeSpan(names);
+
+    cache->store(source, program.getArena(), entry);
+}
+
+Parser::Parser(Parser &parent)
+    : tokens(parent.tokens)
+    , func_def_tracker(parent.func_def_tracker)
+{
+    share_exprs = parent.share_exprs;
 }
 
 void Parser::advanceTokens()
 {
-    cur_token = next_token;
-    lexer->getToken(next_token);
+    ++tok_idx;
+    if (!pipe)
+    {
+        cur_token = tokens->token(tok_idx);
+        return;
+    }
+
+    if (lookahead.empty())
+    {
+        cur_token = pipe->pop();
+        return;
+    }
+    cur_token = lookahead.front();
+    lookahead.pop_front();
 }
 
 void Parser::parseProgram()
@@ -43,116 +144,277 @@ void Parser::parseProgram()
     // we don't support globals or structures...
     while (!cur_token.isTokenEOF())
     {
-        ValueType::Type ret_type;
-        std::unique_ptr<Identifier> iden;
-        std::vector<FuncStatement::Argument> args;
-        std::vector<std::shared_ptr<Statement>> codes;
-
-        // determine return type
-        ret_type = ValueType::typeTokenToValueType(cur_token);
-        if (ret_type == ValueType::Type::MAX)
-        {
-	    std::cerr << "[Error] parseProgram: unsupported return type\n"
-                      << "[Line] " << cur_token.getLine() << "\n";
-	    exit(0);
-        }
-                
-        // function name
+        auto sig = parseSignature();
+
+        // record function def
+        sig.order = recordDefs(sig.iden->getSymbol(), sig.ret_type, sig.args);
+
+        program.addStatement(parseFuncBody(sig));
+        
         advanceTokens();
-        iden = std::make_unique<Identifier>(cur_token);
-        if (!next_token.isTokenLP())
-        {
-            std::cerr << "[Error] Incorrect function defition.\n "
-                      << "[Line] " << cur_token.getLine() << "\n";
-            exit(0);
-	}
+    }
+}
+
+// Function bodies only depend on the signatures before them. A quick
+// first pass records every signature and steps over the bodies by
+// matching braces; then the bodies are parsed on num_threads threads,
+// each worker into its own arena, and put back in source order.
+void Parser::parseProgramParallel(unsigned num_threads)
+{
+    std::vector<FuncSignature> sigs;
+    while (!cur_token.isTokenEOF())
+    {
+        auto sig = parseSignature();
+        sig.order = recordDefs(sig.iden->getSymbol(), sig.ret_type, sig.args);
+        sig.body_begin = tok_idx;
+        sigs.push_back(std::move(sig));
 
+        skipBlock();
         advanceTokens();
-        assert(cur_token.isTokenLP());
+    }
 
-        // Track local variables
-	std::unordered_map<std::string,ValueType::Type> local_vars;
-        local_vars_tracker.push_back(&local_vars);
+    // Workers take the next unparsed function until there are none left
+    std::vector<Statement*> funcs(sigs.size());
+    std::vector<std::unique_ptr<Parser>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_func{0};
 
-        // extract arguments
-        while (!cur_token.isTokenRP())
+    for (unsigned i = 0; i < num_threads; i++)
+    {
+        workers.emplace_back(new Parser(*this));
+        threads.emplace_back([&, worker = workers.back().get()]()
         {
-            advanceTokens();
-            if (cur_token.isTokenRP()) break; // no args
+            for (auto idx = next_func++; idx < sigs.size(); idx = next_func++)
+            {
+                worker->tok_idx = sigs[idx].body_begin;
+                worker->cur_token = tokens->token(worker->tok_idx);
+                funcs[idx] = worker->parseFuncBody(sigs[idx]);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
 
-            std::string arg_type = cur_token.getLiteral();
+    for (auto &worker : workers)
+    {
+        program.getArena().absorb(worker->program.getArena());
+        num_shared += worker->num_shared;
+    }
+    for (auto func : funcs) program.addStatement(func);
+}
 
-            advanceTokens();
-            std::unique_ptr<Identifier> arg_iden(new Identifier(cur_token));
-            FuncStatement::Argument arg(arg_type, arg_iden);
-            args.push_back(arg);
+// Return type, name and arguments, cur_token ends up at the "{" of the body
+Parser::FuncSignature Parser::parseSignature()
+{
+    FuncSignature sig;
 
-            recordLocalVars(arg);
+    // determine return type
+    sig.ret_type = ValueType::typeTokenToValueType(cur_token);
+    if (sig.ret_type == ValueType::Type::MAX)
+    {
+        std::cerr << "[Error] parseProgram: unsupported return type\n"
+                  << curLocation() << "\n";
+        exit(0);
+    }
+            
+    // function name
+    advanceTokens();
+    sig.iden = program.make<Identifier>(cur_token);
+    if (!peekToken().isTokenLP())
+    {
+        std::cerr << "[Error] Incorrect function defition.\n "
+                  << curLocation() << "\n";
+        exit(0);
+    }
 
-            advanceTokens();
-        }
-        assert(cur_token.isTokenRP());
+    advanceTokens();
+    assert(cur_token.isTokenLP());
 
+    // extract arguments
+    while (!cur_token.isTokenRP())
+    {
         advanceTokens();
-        assert(cur_token.isTokenLBrace());
+        if (cur_token.isTokenRP()) break; // no args
 
-        // record function def
-        recordDefs(iden->getLiteral(), ret_type, args);
+        std::string_view arg_type = cur_token.getLiteral();
+
+        advanceTokens();
+        Identifier *arg_iden = program.make<Identifier>(cur_token);
+        FuncStatement::Argument arg(arg_type, arg_iden);
+        sig.args.push_back(arg);
+
+        advanceTokens();
+    }
+    assert(cur_token.isTokenRP());
+
+    advanceTokens();
+    assert(cur_token.isTokenLBrace());
+
+    return sig;
+}
+
+// Body of a recorded function, cur_token is its "{"
+Statement* Parser::parseFuncBody(FuncSignature &sig)
+{
+    std::vector<Statement*> codes;
+    cur_func_order = sig.order;
+
+    // Nothing is shared across functions
+    shared_exprs.clear();
+    num_decls.clear();
+
+    // Track local variables
+    openScope();
+    for (auto &arg : sig.args) recordLocalVars(arg);
+
+    // parse the codes section
+    parseBlocks(sig.iden->getSymbol(), codes);
+
+    Statement *func_proto = 
+        makeStatement<FuncStatement>(sig.ret_type, 
+                                     sig.iden, 
+                                     makeSpan(sig.args), 
+                                     makeSpan(codes));
+    closeScope();
+
+    return func_proto;
+}
 
-        // parse the codes section
-        while (true)
+// Statements of a function body into codes, from its "{" to its "}".
+// An if/for/while opens a block on an explicit stack instead of being
+// parsed by a recursive call, so blocks can nest to any depth.
+void Parser::parseBlocks(Symbol cur_func_name,
+                         std::vector<Statement*> &codes)
+{
+    std::vector<OpenBlock> blocks;
+    blocks.push_back({StatementType::FUNC_STATEMENT});
+
+    while (true)
+    {
+        advanceTokens();
+        if (cur_token.isTokenRBrace())
         {
-            advanceTokens();
-            if (cur_token.isTokenRBrace())
-                    break;
+            if (closeBlock(blocks)) break;
+            continue;
+        }
+
+        cur_expr_type = ValueType::Type::MAX;
 
-            parseStatement(iden->getLiteral(), codes);
+        if (cur_token.isTokenIf())
+        {
+            blocks.push_back(parseIfStatement());
+            continue;
+        }
+        if (cur_token.isTokenFor())
+        {
+            blocks.push_back(parseForStatement());
+            continue;
+        }
+        if (cur_token.isTokenWhile())
+        {
+            blocks.push_back(parseWhileStatement());
+            continue;
         }
 
-        std::unique_ptr<Statement> func_proto
-            (new FuncStatement(ret_type, 
-                               iden, 
-                               args, 
-                               codes,
-                               local_vars));
-        local_vars_tracker.pop_back();
+        parseStatement(cur_func_name, blocks.back().codes);
 
-        program.addStatement(func_proto);
-        
-        advanceTokens();
+        // A statement inside an if/for/while may run into the closing
+        // "}" (a function body always steps over it)
+        if (blocks.size() > 1 && cur_token.isTokenRBrace())
+        {
+            closeBlock(blocks);
+        }
     }
+    codes = std::move(blocks.back().codes);
 }
 
-void Parser::parseStatement(std::string &cur_func_name, 
-                            std::vector<std::shared_ptr<Statement>> &codes)
+// The innermost block is done, cur_token is its "}". Either the else
+// block of an if follows, or the statement is complete and goes into
+// the block around it. True if it was the function body.
+bool Parser::closeBlock(std::vector<OpenBlock> &blocks)
 {
-    cur_expr_type = ValueType::Type::MAX;
+    auto &block = blocks.back();
+    if (block.kind == StatementType::FUNC_STATEMENT) return true;
 
-    // is it an if statement?
-    if (cur_token.isTokenIf())
-    {
-        auto code = parseIfStatement(cur_func_name);
-        codes.push_back(std::move(code));
-        return;
-    }
+    assert(cur_token.isTokenRBrace());
+    closeScope();
 
-    if (cur_token.isTokenFor())
+    Statement *statement = nullptr;
+    switch (block.kind)
     {
-       auto code = parseForStatement(cur_func_name);
-       codes.push_back(std::move(code));
-       return;
+        case StatementType::IF_STATEMENT:
+            if (!block.in_else)
+            {
+                block.taken = std::move(block.codes);
+                block.codes.clear();
+
+                if (peekToken().isTokenElse())
+                {
+                    advanceTokens();
+                    openScope();
+                    advanceTokens();
+                    block.in_else = true;
+                    return false;
+                }
+            }
+            statement = makeStatement<IfStatement>(block.cond,
+                                                   makeSpan(block.taken),
+                                                   makeSpan(block.codes));
+            break;
+        case StatementType::FOR_STATEMENT:
+            statement = makeStatement<ForStatement>(block.start, block.cond,
+                                                    block.step,
+                                                    makeSpan(block.codes));
+            break;
+        case StatementType::WHILE_STATEMENT:
+            statement = makeStatement<WhileStatement>(block.cond,
+                                                      makeSpan(block.codes));
+            break;
+        default:
+            assert(false && "closeBlock: not a block");
     }
 
-    if (cur_token.isTokenWhile())
+    blocks.pop_back();
+    blocks.back().codes.push_back(statement);
+    return false;
+}
+
+// From a "{" to its matching "}", without parsing what is in between
+void Parser::skipBlock()
+{
+    assert(cur_token.isTokenLBrace());
+
+    size_t depth = 0;
+    for (;; tok_idx++)
     {
-       auto code = parseWhileStatement(cur_func_name);
-       codes.push_back(std::move(code));
-       return;
+        auto type = tokens->type(tok_idx);
+        if (type == Token::TokenType::TOKEN_LBRACE)
+        {
+            depth++;
+        }
+        else if (type == Token::TokenType::TOKEN_RBRACE)
+        {
+            if (--depth == 0) break;
+        }
+        else if (type == Token::TokenType::TOKEN_EOF)
+        {
+            std::cerr << "[Error] parseProgram: unbalanced braces\n"
+                      << curLocation() << "\n";
+            exit(0);
+        }
     }
+    cur_token = tokens->token(tok_idx);
+}
+
+void Parser::parseStatement(Symbol cur_func_name, 
+                            std::vector<Statement*> &codes)
+{
+    cur_expr_type = ValueType::Type::MAX;
+
+    // if/for/while are blocks, see parseBlocks
 
     // is it a function call?
     if (auto [is_def, is_built_in] = 
-            isFuncDef(cur_token.getLiteral());
+            isFuncDef(cur_token.getSymbol());
         is_def)
     {
         Statement::StatementType call_type = is_built_in ?
@@ -160,10 +422,10 @@ void Parser::parseStatement(std::string &cur_func_name,
             Statement::StatementType::NORMAL_CALL_STATEMENT;
 
         auto code = parseCall();
-        std::unique_ptr<CallStatement> call = 
-            std::make_unique<CallStatement>(code, call_type); 
+        Statement *call = 
+            makeStatement<CallStatement>(code, call_type); 
 
-        codes.push_back(std::move(call));
+        codes.push_back(call);
 
         return;
     }
@@ -176,10 +438,10 @@ void Parser::parseStatement(std::string &cur_func_name,
         cur_expr_type = getFuncRetType(cur_func_name);
         auto ret = parseExpression();
 
-        std::unique_ptr<RetStatement> ret_statement = 
-            std::make_unique<RetStatement>(ret);
+        Statement *ret_statement = 
+            makeStatement<RetStatement>(ret);
 
-        codes.push_back(std::move(ret_statement));
+        codes.push_back(ret_statement);
 
         return;
     }
@@ -190,13 +452,13 @@ void Parser::parseStatement(std::string &cur_func_name,
     {
         auto code = parseAssnStatement();
 
-        codes.push_back(std::move(code));
+        codes.push_back(code);
 
         return;
     }
 }
 
-std::unique_ptr<Statement> Parser::parseAssnStatement()
+Statement* Parser::parseAssnStatement()
 {
     // Allocating new variables
     if (isTokenTypeKeyword(cur_token))
@@ -209,19 +471,19 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
         {
             std::cerr << "[Error] Re-definition of "
                       << cur_token.getLiteral() << "\n";
-            std::cerr << "[Line] " << cur_token.getLine() << "\n";
+            std::cerr << curLocation() << "\n";
             exit(0);
         }
 
-        bool is_array = (next_token.isTokenLBracket()) ? 
+        bool is_array = (peekToken().isTokenLBracket()) ? 
                         true : false;
 
         recordLocalVars(cur_token, type_token, is_array);
 
-        std::unique_ptr<Expression> iden =
-            std::make_unique<LiteralExpression>(cur_token);
+        // The same node as the variable's uses
+        Expression *iden = makeLiteralExpr(cur_token);
 
-	std::unique_ptr<Expression> expr;
+	Expression *expr = nullptr;
         if (!is_array)
         {
             advanceTokens();
@@ -236,12 +498,12 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
 	       if (type_token.getTokenType() == Token::TokenType::TOKEN_INT) {
                   Token::TokenType type = Token::TokenType::TOKEN_INT;
                   Token _tok(type);
-	          expr = std::make_unique<LiteralExpression>(_tok);
+	          expr = makeExpr<LiteralExpression>(_tok);
 	       }
 	       if (type_token.getTokenType() == Token::TokenType::TOKEN_FLOAT) {
                   Token::TokenType type = Token::TokenType::TOKEN_FLOAT;
                   Token _tok(type);
-	          expr = std::make_unique<LiteralExpression>(_tok);
+	          expr = makeExpr<LiteralExpression>(_tok);
 	       }
             }
         }
@@ -250,8 +512,10 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
             expr = parseArrayExpr();
         }
 	
-        std::unique_ptr<Statement> statement = 
-            std::make_unique<AssnStatement>(iden, expr);
+        auto decl_type = 
+            ValueType::typeTokenToValueType(type_token, is_array);
+        Statement *statement = 
+            makeStatement<AssnStatement>(iden, expr, decl_type);
 
         return statement;
     }
@@ -262,7 +526,7 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
         {
             std::cerr << "[Error] Undefined variable of "
                       << cur_token.getLiteral() << "\n";
-            std::cerr << "[Line] " << cur_token.getLine() << "\n";
+            std::cerr << curLocation() << "\n";
             exit(0);
         }
 
@@ -272,7 +536,7 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
         assert(cur_token.isTokenEqual());
         advanceTokens();
 
-	std::unique_ptr<Expression> expr;
+	Expression *expr = nullptr;
         if (type == ValueType::Type::INT_ARRAY || 
             type == ValueType::Type::FLOAT_ARRAY)
         {
@@ -288,14 +552,14 @@ std::unique_ptr<Statement> Parser::parseAssnStatement()
 
         expr = parseExpression();
         
-        std::unique_ptr<Statement> statement = 
-            std::make_unique<AssnStatement>(iden, expr);
+        Statement *statement = 
+            makeStatement<AssnStatement>(iden, expr);
 
         return statement;
     }
 }
 
-std::unique_ptr<Expression> Parser::parseArrayExpr()
+Expression* Parser::parseArrayExpr()
 {
     advanceTokens();
     assert(cur_token.isTokenLBracket());
@@ -306,27 +570,30 @@ std::unique_ptr<Expression> Parser::parseArrayExpr()
     cur_expr_type = ValueType::Type::INT;
     auto num_ele = parseExpression();
     cur_expr_type = swap;
+
+    // A constant expression is as good as a literal
+    ASTFolder(program).fold(num_ele);
     if (!(num_ele->isExprLiteral()))
     {
         std::cerr << "[Error] Number of array elements "
-                  << "must be a single integer. \n"
-                  << "[Line] " << cur_token.getLine() << "\n";
+                  << "must be an integer constant. \n"
+                  << curLocation() << "\n";
         exit(0);
     }
-    auto num_ele_lit = static_cast<LiteralExpression*>(num_ele.get());
+    auto num_ele_lit = num_ele->as<LiteralExpression>();
     if (!(num_ele_lit->isLiteralInt()))
     {
         std::cerr << "[Error] Number of array elements "
-                  << "must be a single integer. \n"
-                  << "[Line] " << cur_token.getLine() << "\n";
+                  << "must be an integer constant. \n"
+                  << curLocation() << "\n";
         exit(0);
     }
-    int num_eles_int = stoi(num_ele_lit->getLiteral());
+    int num_eles_int = num_ele_lit->getInt();
     if (num_eles_int <= 1)
     {
         std::cerr << "[Error] Number of array elements "
                   << "must be larger than 1. \n"
-                  << "[Line] " << cur_token.getLine() << "\n";
+                  << curLocation() << "\n";
         exit(0);
     }
 
@@ -338,8 +605,8 @@ std::unique_ptr<Expression> Parser::parseArrayExpr()
     advanceTokens();
     assert(cur_token.isTokenLBrace());
 
-    std::vector<std::shared_ptr<Expression>> eles;
-    if (!next_token.isTokenRBrace())
+    std::vector<Expression*> eles;
+    if (!peekToken().isTokenRBrace())
     {
         advanceTokens();
         while (!cur_token.isTokenRBrace())
@@ -356,7 +623,7 @@ std::unique_ptr<Expression> Parser::parseArrayExpr()
                       << "(1) pre-allocation style - array<int> x[10] = {} "
                       << "(2) #initials == #elements - "
                       << "array<int> x[2] = {1, 2} \n"
-                      << "[Line] " << cur_token.getLine() << "\n";
+                      << curLocation() << "\n";
             exit(0);
         }
     }
@@ -367,46 +634,25 @@ std::unique_ptr<Expression> Parser::parseArrayExpr()
 
     advanceTokens();
 
-    std::unique_ptr<Expression> ret = 
-        std::make_unique<ArrayExpression>(num_ele, eles);
-
-    return ret;
-}
-
-std::unique_ptr<Expression> Parser::parseIndex()
-{
-    std::unique_ptr<Identifier> iden(new Identifier(cur_token));
-
-    advanceTokens();
-    assert(cur_token.isTokenLBracket());
-
-    advanceTokens();
-
-    // Index must be an integer
-    auto swap = cur_expr_type;
-    cur_expr_type = ValueType::Type::INT;
-    auto idx = parseExpression();
-    cur_expr_type = swap;
-
-    std::unique_ptr<Expression> ret = 
-        std::make_unique<IndexExpression>(iden, idx);
-
-    assert(cur_token.isTokenRBracket());
+    Expression *ret = 
+        makeExpr<ArrayExpression>(num_ele, makeSpan(eles));
 
     return ret;
 }
 
-std::unique_ptr<Expression> Parser::parseCall()
+// Call at statement level, cur_token is the function name and ends up
+// at its ")". Calls inside expressions are parsed by parseExpression.
+Expression* Parser::parseCall()
 {
-    std::unique_ptr<Identifier> def(new Identifier(cur_token));
+    Identifier *def = program.make<Identifier>(cur_token);
 
     advanceTokens();
     assert(cur_token.isTokenLP());
 
     advanceTokens();
-    std::vector<std::shared_ptr<Expression>> args;
+    auto arg_base = call_args.size();
 
-    auto &arg_types = getFuncArgTypes(def->getLiteral());
+    auto &arg_types = getFuncArgTypes(def->getSymbol());
     unsigned idx = 0;
     while (!cur_token.isTokenRP())
     {
@@ -415,7 +661,7 @@ std::unique_ptr<Expression> Parser::parseCall()
 
         auto swap = cur_expr_type;
         cur_expr_type = arg_types[idx++];
-        args.push_back(parseExpression());
+        call_args.push_back(parseExpression());
         cur_expr_type = swap;
 
         if (cur_token.isTokenRP())
@@ -423,22 +669,30 @@ std::unique_ptr<Expression> Parser::parseCall()
         advanceTokens();
     }
 
-    std::unique_ptr<Expression> ret = 
-        std::make_unique<CallExpression>(def, args);
+    return makeCallExpr(def, arg_base);
+}
 
-    return ret;
+// Call of def on the arguments on call_args from arg_base, which are
+// taken off
+Expression* Parser::makeCallExpr(Identifier *def, size_t arg_base)
+{
+    std::vector<Expression*> args(call_args.begin() + arg_base,
+                                  call_args.end());
+    call_args.resize(arg_base);
+
+    return makeExpr<CallExpression>(def, makeSpan(args));
 }
 
-std::unique_ptr<Condition> Parser::parseCondition()
+Condition* Parser::parseCondition()
 {
     // Left condition
     auto cond_left = parseExpression();
 
     // Comp operator
-    std::string comp_opr_str = cur_token.getLiteral();
-    if (next_token.isTokenEqual())
+    std::string comp_opr_str(cur_token.getLiteral());
+    if (peekToken().isTokenEqual())
     {
-        comp_opr_str += next_token.getLiteral();
+        comp_opr_str += peekToken().getLiteral();
         advanceTokens();
     }
 
@@ -447,160 +701,59 @@ std::unique_ptr<Condition> Parser::parseCondition()
     auto cond_right = parseExpression();
 
     // Build up the condition object
-    std::unique_ptr<Condition> cond = 
-        std::make_unique<Condition>(cond_left,
-                                    cond_right,
-                                    comp_opr_str,
-                                    cur_expr_type);
+    Condition *cond = 
+        program.make<Condition>(cond_left,
+                                cond_right,
+                                comp_opr_str,
+                                cur_expr_type);
     return cond;
 }
 
-std::unique_ptr<Statement> Parser::parseIfStatement(std::string& 
-                                                    parent_func_name)
+// The headers of if, while and for, up to the "{" of the block; the
+// block itself is parsed by parseBlocks
+Parser::OpenBlock Parser::parseIfStatement()
 {
+    OpenBlock block{StatementType::IF_STATEMENT};
+
     advanceTokens();
     assert(cur_token.isTokenLP());
 
     advanceTokens();
-    auto cond = parseCondition();
+    block.cond = parseCondition();
 
     // Parse taken block
     advanceTokens();
     assert(cur_token.isTokenLBrace());
+    openScope();
 
-    std::vector<std::shared_ptr<Statement>> taken_block_codes;
-    std::unordered_map<std::string,ValueType::Type> taken_block_local_vars;
-    local_vars_tracker.push_back(&taken_block_local_vars);
-    while (true)
-    {
-        advanceTokens();
-        if (cur_token.isTokenRBrace())
-            break;
-
-        parseStatement(parent_func_name, taken_block_codes);
-        // We just finished an if/for statement
-        if (taken_block_codes.back()->isStatementIf() ||
-            taken_block_codes.back()->isStatementFor() ||
-            taken_block_codes.back()->isStatementWhile())
-        {
-            // This RBrace is from the statement,
-            // should not terminate.
-            assert(cur_token.isTokenRBrace());
-        }
-        else
-        {
-            if (cur_token.isTokenRBrace())
-                break;
-        }
-    }
-    assert(cur_token.isTokenRBrace());
-    local_vars_tracker.pop_back();
-
-    // Parse else block
-    std::vector<std::shared_ptr<Statement>> not_taken_block_codes;
-    std::unordered_map<std::string,
-                       ValueType::Type> not_taken_block_local_vars;
-
-    if (next_token.isTokenElse())
-    {
-        advanceTokens();
-        local_vars_tracker.push_back(&not_taken_block_local_vars);
-        advanceTokens();
-        while (true)
-        {
-            advanceTokens();
-            if (cur_token.isTokenRBrace())
-                break;
-
-            parseStatement(parent_func_name, not_taken_block_codes);
-            // We just finished an if/for statement
-            if (not_taken_block_codes.back()->isStatementIf() ||
-                not_taken_block_codes.back()->isStatementFor() ||
-                not_taken_block_codes.back()->isStatementWhile())
-            {
-                // This RBrace is from the statement,
-                // should not terminate.
-                assert(cur_token.isTokenRBrace());
-            }
-            else
-            {
-                if (cur_token.isTokenRBrace())
-                    break;
-            }
-        }
-        assert(cur_token.isTokenRBrace());
-        local_vars_tracker.pop_back();
-    }
-
-    std::unique_ptr<Statement> if_statement = 
-        std::make_unique<IfStatement>(cond, 
-                                      taken_block_codes,
-                                      not_taken_block_codes,
-                                      taken_block_local_vars,
-                                      not_taken_block_local_vars);
-    
-    assert(cur_token.isTokenRBrace());
-    return if_statement;
+    return block;
 }
 
-std::unique_ptr<Statement> Parser::parseWhileStatement(std::string& parent_func_name)
+Parser::OpenBlock Parser::parseWhileStatement()
 {
-    std::vector<std::shared_ptr<Statement>> for_block_codes;
-    std::unordered_map<std::string,ValueType::Type> for_block_local_vars;
-    local_vars_tracker.push_back(&for_block_local_vars);
+    OpenBlock block{StatementType::WHILE_STATEMENT};
+    openScope();
 
-    // move past "for"
+    // move past "while"
     advanceTokens();
 
     // move past "( {{end}} )"
     assert(cur_token.isTokenLP());
     advanceTokens();
-    auto end = parseCondition();
+    block.cond = parseCondition();
     assert(cur_token.isTokenRP());
     advanceTokens();
 
-    // Parse for block
+    // Parse while block
     assert(cur_token.isTokenLBrace());
 
-    while (true)
-    {
-        advanceTokens();
-        if (cur_token.isTokenRBrace())
-            break;
-
-        parseStatement(parent_func_name, for_block_codes);
-        // We just finished an if/for statement
-        if (for_block_codes.back()->isStatementIf() ||
-            for_block_codes.back()->isStatementFor() ||
-            for_block_codes.back()->isStatementWhile())
-        {
-            // This RBrace is from the statement,
-            // should not terminate.
-            assert(cur_token.isTokenRBrace());
-        }
-        else
-        {
-            if (cur_token.isTokenRBrace())
-                break;
-        }
-    }
-    assert(cur_token.isTokenRBrace());
-    local_vars_tracker.pop_back();
-    
-    std::unique_ptr<Statement> for_statement = 
-        std::make_unique<WhileStatement>(end, for_block_codes, for_block_local_vars);
-    
-    assert(cur_token.isTokenRBrace());
-    
-    return for_statement;
+    return block;
 }
 
-std::unique_ptr<Statement> Parser::parseForStatement(std::string& 
-                                                     parent_func_name)
+Parser::OpenBlock Parser::parseForStatement()
 {
-    std::vector<std::shared_ptr<Statement>> for_block_codes;
-    std::unordered_map<std::string,ValueType::Type> for_block_local_vars;
-    local_vars_tracker.push_back(&for_block_local_vars);
+    OpenBlock block{StatementType::FOR_STATEMENT};
+    openScope();
 
     // move past "for"
     advanceTokens();
@@ -610,455 +763,242 @@ std::unique_ptr<Statement> Parser::parseForStatement(std::string&
     advanceTokens();
  
     // get the initial value, move past semicolon
-    auto start = parseAssnStatement();
+    block.start = parseAssnStatement();
     assert(cur_token.isTokenSemicolon());
     advanceTokens();
     
     // get the condition, move past semicolon
-    auto end = parseCondition();
+    block.cond = parseCondition();
     assert(cur_token.isTokenSemicolon());
     advanceTokens();
  
     // get the reassignment, move past ")"
-    auto step = parseAssnStatement();
+    block.step = parseAssnStatement();
     assert(cur_token.isTokenRP());
     advanceTokens();
 
     // Parse for block
     assert(cur_token.isTokenLBrace());
 
-    while (true)
-    {
-        advanceTokens();
-        if (cur_token.isTokenRBrace())
-            break;
-
-        parseStatement(parent_func_name, for_block_codes);
-        // We just finished an if/for statement
-        if (for_block_codes.back()->isStatementIf() ||
-            for_block_codes.back()->isStatementFor() ||
-            for_block_codes.back()->isStatementWhile())
-        {
-            // This RBrace is from the statement,
-            // should not terminate.
-            assert(cur_token.isTokenRBrace());
-        }
-        else
-        {
-            if (cur_token.isTokenRBrace())
-                break;
-        }
-    }
-    assert(cur_token.isTokenRBrace());
-    local_vars_tracker.pop_back();
-    
-    std::unique_ptr<Statement> for_statement = 
-        std::make_unique<ForStatement>(start, end, step, for_block_codes, for_block_local_vars);
-    
-    assert(cur_token.isTokenRBrace());
-    
-    return for_statement;
+    return block;
 }
 
 
-std::unique_ptr<Expression> Parser::parseExpression()
+// Operator precedence parsing on explicit stacks. Operands and pending
+// operators are pushed instead of recursed on: a binary operator first
+// reduces every pending one of the same or a tighter level (so operators
+// of a level associate to the left and tighter ones end up deeper in the
+// tree), a unary minus applies to the factor right after it. Parentheses,
+// array indices and call arguments each open an ExprGroup, so neither
+// long operator chains nor deep nesting use native stack.
+Expression* Parser::parseExpression()
 {
-    std::unique_ptr<Expression> left = parseTerm();
+    auto group_base = expr_groups.size();
+    openExprGroup(ExprGroup::Kind::TOP);
 
+    bool have_operand = false;
     while (true)
     {
-        if (cur_token.isTokenPlus() || 
-            cur_token.isTokenMinus())
+        if (!have_operand)
         {
-            Expression::ExpressionType expr_type;
+            // Prefix operators and parentheses, then a factor
             if (cur_token.isTokenPlus())
             {
-                expr_type = Expression::ExpressionType::PLUS;
+                advanceTokens();
+                continue;
             }
-            else
+            if (cur_token.isTokenMinus())
+            {
+                advanceTokens();
+                expr_oprs.push_back(nullptr);
+                continue;
+            }
+            if (cur_token.isTokenLP())
             {
-                expr_type = Expression::ExpressionType::MINUS;
+                advanceTokens();
+                openExprGroup(ExprGroup::Kind::PAREN);
+                continue;
             }
 
-            advanceTokens();
+            // TODO - add deref in the future
+            bool is_index = (peekToken().isTokenLBracket()) ?
+                            true : false;
 
-            std::unique_ptr<Expression> right;
+            strictTypeCheck(cur_token, is_index);
 
-            // Priority one. ()
-            if (cur_token.isTokenLP())
+            if (is_index)
             {
-                right = parseTerm();
-                left = std::make_unique<ArithExpression>(left, 
-                       right, 
-                       expr_type);
+                Identifier *iden = program.make<Identifier>(cur_token);
+
+                advanceTokens();
+                assert(cur_token.isTokenLBracket());
+                advanceTokens();
+
+                // Index must be an integer
+                openExprGroup(ExprGroup::Kind::INDEX, iden);
+                cur_expr_type = ValueType::Type::INT;
                 continue;
             }
-            
-            // Priority two. *, /
-            // check if the next token is a function call
-	    std::unique_ptr<Expression> pending_expr = nullptr;
+
             if (auto [is_def, is_built_in] = 
-                    isFuncDef(cur_token.getLiteral());
+                    isFuncDef(cur_token.getSymbol());
                     is_def)
             {
-                strictTypeCheck(cur_token);
-                pending_expr = parseCall();
-            }
+                Identifier *def = program.make<Identifier>(cur_token);
 
-            // check if the next token is an array index
-            // TODO - add deref in the future
-            if (bool is_index = (next_token.isTokenLBracket()) ?
-                                true : false;
-                is_index)
-            {
-                assert(pending_expr == nullptr);
-                strictTypeCheck(cur_token, is_index);
-                pending_expr = parseIndex();
-            }
+                advanceTokens();
+                assert(cur_token.isTokenLP());
+                advanceTokens();
 
-            if (next_token.isTokenAsterisk() ||
-                next_token.isTokenSlash())
-            {
-                if (pending_expr != nullptr)
-                {
-                    advanceTokens();
-                    right = parseTerm(std::move(pending_expr));
-                }
-                else
+                if (!cur_token.isTokenRP())
                 {
-                    right = parseTerm();
+                    openExprGroup(ExprGroup::Kind::CALL, def);
+                    cur_expr_type = getFuncArgTypes(def->getSymbol())[0];
+                    continue;
                 }
+                expr_operands.push_back(makeCallExpr(def, call_args.size()));
             }
             else
             {
-                if (pending_expr != nullptr)
-                {
-                    right = std::move(pending_expr);
-                    advanceTokens();
-                }
-                else
-                {
-                    // Could be a literal or unary expression
-                    right = parseFactor();
-                }
+                expr_operands.push_back(makeLiteralExpr(cur_token));
             }
-
-            left = std::make_unique<ArithExpression>(left, 
-                       right, 
-                       expr_type);
-        }
-        else
-        {
-            return left;
+            advanceTokens();
+            have_operand = true;
         }
-    }
-}
 
-// For Div/Mul
-std::unique_ptr<Expression> Parser::parseTerm(
-    std::unique_ptr<Expression> pending_left)
-{   
-    std::unique_ptr<Expression> left = 
-        (pending_left != nullptr) ? std::move(pending_left) : parseFactor();
+        // A factor is complete, apply the unary minuses before it
+        auto &group = expr_groups.back();
+        while (expr_oprs.size() > group.opr_base && expr_oprs.back() == nullptr)
+            reduceExpr();
 
-    while (true)
-    {
-        if (cur_token.isTokenAsterisk() || 
-            cur_token.isTokenSlash())
+        if (auto opr = binaryOperator(cur_token))
         {
-            Expression::ExpressionType expr_type;
-            if (cur_token.isTokenAsterisk())
-            {
-                expr_type = Expression::ExpressionType::ASTERISK;
-            }
-            else
+            while (expr_oprs.size() > group.opr_base &&
+                   expr_oprs.back()->prec >= opr->prec)
             {
-                expr_type = Expression::ExpressionType::SLASH;
+                reduceExpr();
             }
+            expr_oprs.push_back(opr);
 
             advanceTokens();
+            have_operand = false;
+            continue;
+        }
 
-            std::unique_ptr<Expression> right;
+        // The group ends here
+        while (expr_oprs.size() > group.opr_base) reduceExpr();
+        assert(expr_operands.size() == group.operand_base + 1);
 
-            // We are trying to mul/div something with higher priority
-            if (cur_token.isTokenLP()) 
+        auto closed = group;
+        auto result = expr_operands.back();
+        expr_operands.pop_back();
+        expr_groups.pop_back();
+
+        switch (closed.kind)
+        {
+            case ExprGroup::Kind::TOP:
+                assert(expr_groups.size() == group_base);
+                return result;
+
+            case ExprGroup::Kind::PAREN:
+                assert(cur_token.isTokenRP()); // Error checking
+                advanceTokens();
+                expr_operands.push_back(result);
+                break;
+
+            case ExprGroup::Kind::INDEX:
             {
-                right = parseTerm();
+                cur_expr_type = closed.outer_type;
+                auto iden = closed.iden;
+                expr_operands.push_back(shareExpr(
+                    ExprKey{ExpressionType::INDEX, {},
+                            varKey(iden->getSymbol()), result},
+                    [&]() { return makeExpr<IndexExpression>(iden, result); }));
+
+                assert(cur_token.isTokenRBracket());
+                advanceTokens();
+                break;
             }
-            else
+
+            case ExprGroup::Kind::CALL:
             {
-                // TODO - add deref in the future
-                bool is_index = (next_token.isTokenLBracket()) ?
-                                true : false;
+                cur_expr_type = closed.outer_type;
+                call_args.push_back(result);
 
-                if (is_index)
-                {
-                    // Make sure the array type is consistent
-                    strictTypeCheck(cur_token, is_index);
-                    right = parseIndex();
-                    advanceTokens();
-                }
-                else if (auto [is_def, is_built_in] = 
-                            isFuncDef(cur_token.getLiteral());
-                            is_def)
+                if (!cur_token.isTokenRP())
                 {
-                    // Make sure the function return type is consistent
-                    strictTypeCheck(cur_token, is_index);
-                    right = parseCall();
+                    // past the ",", on to the next argument
                     advanceTokens();
+                    if (!cur_token.isTokenRP())
+                    {
+                        auto &arg_types =
+                            getFuncArgTypes(closed.iden->getSymbol());
+                        auto idx = call_args.size() - closed.arg_base;
+
+                        expr_groups.push_back(closed);
+                        expr_groups.back().operand_base = expr_operands.size();
+                        expr_groups.back().opr_base = expr_oprs.size();
+                        cur_expr_type = arg_types[idx];
+                        have_operand = false;
+                        continue;
+                    }
                 }
-                else
-                {
-                    // Could be a literal or unary expression
-                    right = parseFactor();
-                }
+                expr_operands.push_back(makeCallExpr(closed.iden,
+                                                     closed.arg_base));
+                advanceTokens();
+                break;
             }
-
-            left = std::make_unique<ArithExpression>(left, 
-                       right, 
-                       expr_type);
-
-        }
-        else
-        {
-            break;
         }
-
     }
-
-    return left;
 }
 
-// Deal with () here
-std::unique_ptr<Expression> Parser::parseFactor()
+void Parser::openExprGroup(ExprGroup::Kind kind, Identifier *iden)
 {
-    std::unique_ptr<Expression> left;
-
-    if (cur_token.isTokenPlus()) {
-       advanceTokens();
-       left = parseFactor();
-       return left;
-    }
-
-    if (cur_token.isTokenMinus()) {
-        // move past the - token
-	advanceTokens();
-
-	// get the factor
-        std::unique_ptr<Expression> right = parseFactor();
-
-	// using the type of the factor, create corresponding zero token
-	Token::TokenType type;
-	std::string zero;
-
-	if (cur_expr_type == ValueType::Type::INT) {
-           zero = "0";
-	   type = Token::TokenType::TOKEN_INT;
-	} else if (cur_expr_type == ValueType::Type::FLOAT) {
-           zero = "0.0";
-	   type = Token::TokenType::TOKEN_FLOAT;
-	} else {
-	   std::cerr << "[Error] invalid unary operation" << std::endl;
-	}
-
-	Token _tok(type, zero);
-	left = std::make_unique<LiteralExpression>(_tok);
-
-	// return 0 - factor
-	return std::make_unique<ArithExpression>(left, right, Expression::ExpressionType::MINUS);
-    }
-
-    if (cur_token.isTokenLP())
-    {
-        advanceTokens();
-        left = parseExpression();
-        assert(cur_token.isTokenRP()); // Error checking
-        advanceTokens();
-        return left;
-    }
-    
-    // TODO - add deref in the future
-    bool is_index = (next_token.isTokenLBracket()) ?
-                    true : false;
-
-    strictTypeCheck(cur_token, is_index);
-    
-    if (is_index)
-        left = parseIndex();
-    else if (auto [is_def, is_built_in] = 
-                 isFuncDef(cur_token.getLiteral());
-                 is_def)
-        left = parseCall();
-    else
-        left = std::make_unique<LiteralExpression>(cur_token);
-
-    advanceTokens();
-
-    return left;
+    ExprGroup group{kind, expr_operands.size(), expr_oprs.size()};
+    group.outer_type = cur_expr_type;
+    group.iden = iden;
+    group.arg_base = call_args.size();
+    expr_groups.push_back(group);
 }
 
-
-void RetStatement::printStatement()
+// Apply the operator on top of expr_oprs to the operands it takes
+void Parser::reduceExpr()
 {
-    std::cout << "    {\n";
-    std::cout << "      [Return]\n";
-    if (ret->getType() == Expression::ExpressionType::LITERAL)
-    {
-        std::cout << "      " << ret->print(4);
-    }
-    else
-    {
-        std::cout << ret->print(4);
-    }
-    std::cout << "    }\n";
-}
-
-void AssnStatement::printStatement()
-{
-    std::cout << "    {\n";
-    if (iden->getType() == Expression::ExpressionType::LITERAL)
-    {
-        std::cout << "      " << iden->print(4);
-    }
-    else
-    {
-        std::cout << iden->print(4);
-    }
+    auto opr = expr_oprs.back();
+    expr_oprs.pop_back();
 
-    std::cout << "      =\n";
-
-    // might have an uninitialized assignment
-    // which will be printed as just "{{iden}} ="
-    if (expr != NULL) {
-       if (expr->getType() == Expression::ExpressionType::LITERAL)
-       {
-           std::cout << "      " << expr->print(4);
-       }
-       else
-       {
-           std::cout << expr->print(4);
-       }
-    }
-    std::cout << "    }\n";
-}
-
-void FuncStatement::printStatement()
-{
-    std::cout << "{\n";
-    std::cout << "  Function Name: " << iden->print() << "\n";
-    std::cout << "  Return Type: ";
-    if (func_type == ValueType::Type::VOID)
-    {
-        std::cout << "void\n";
-    }
-    else if (func_type == ValueType::Type::INT)
-    {
-        std::cout << "int\n";
-    }
-    else if (func_type == ValueType::Type::FLOAT)
-    {
-        std::cout << "float\n";
-    }
+    Expression *right = expr_operands.back();
+    expr_operands.pop_back();
 
-    std::cout << "  Arguments\n";
-    for (auto &arg : args)
+    if (opr != nullptr)
     {
-        std::cout << "    " << arg.print() << "\n";
-    }
-    if (!args.size()) std::cout << "    NONE\n";
-
-    std::cout << "  Codes\n";
-    std::cout << "  {\n";
-    for (auto &code : codes)
-    {
-        code->printStatement();
-    }
-    std::cout << "  }\n";
-    std::cout << "}\n";
-}
-
-void IfStatement::printStatement()
-{
-    std::cout << "  {\n";
-    std::cout << "  [IF Statement] \n";
-    std::cout << "  [Condition]\n";
-    cond->printStatement();
-    std::cout << "  [Taken Block]\n";
-    std::cout << "  {\n";
-    for (auto &code : taken_block)
-    {
-        code->printStatement();
-    }
-    std::cout << "  }\n";
-    if (not_taken_block.size() == 0)
-    {
-        std::cout << "  }\n";
+        Expression *left = expr_operands.back();
+        expr_operands.back() = makeArithExpr(left, right, opr->expr_type);
         return;
     }
-    std::cout << "  [Not Taken Block]\n";
-    std::cout << "  {\n";
-    for (auto &code : not_taken_block)
-    {
-        code->printStatement();
-    }
-    std::cout << "  }\n";
-    std::cout << "  }\n";
 
-}
+    // using the type of the factor, create corresponding zero token
+    Token::TokenType type;
+    std::string_view zero;
 
-void ForStatement::printStatement()
-{
-    std::cout << "  {\n";
-    std::cout << "  [For Statement] \n";
-    std::cout << "  [Start]\n";
-    start->printStatement();
-    std::cout << "  [End]\n";
-    end->printStatement();
-    std::cout << "  [Step]\n";
-    step->printStatement();
-
-    std::cout << "  [Block]\n";
-    std::cout << "  {\n";
-    for (auto &code : block)
-    {
-        code->printStatement();
+    if (cur_expr_type == ValueType::Type::INT) {
+       zero = "0";
+       type = Token::TokenType::TOKEN_INT;
+    } else if (cur_expr_type == ValueType::Type::FLOAT) {
+       zero = "0.0";
+       type = Token::TokenType::TOKEN_FLOAT;
+    } else {
+       std::cerr << "[Error] invalid unary operation" << std::endl;
+       exit(0);
     }
-    std::cout << "  }\n";
-    std::cout << "  }\n";
-
-}
 
-void WhileStatement::printStatement()
-{
-    std::cout << "  {\n";
-    std::cout << "  [While Statement] \n";
-    std::cout << "  [End]\n";
-    end->printStatement();
-    std::cout << "  [Block]\n";
-    std::cout << "  {\n";
-    for (auto &code : block)
-    {
-        code->printStatement();
-    }
-    std::cout << "  }\n";
-    std::cout << "  }\n";
+    // the text goes into the arena, the tree must not point into
+    // the binary (see parser/cache.hh)
+    Token _tok(type, program.getArena().copy(zero));
+    Expression *left = makeLiteralExpr(_tok);
 
-}
-
-void Condition::printStatement()
-{
-    std::cout << "  {\n";
-    std::cout << "    [Left]\n";
-    if (left->getType() == Expression::ExpressionType::LITERAL)
-        std::cout << "      " << left->print(3) << "\n";
-    else
-        std::cout << left->print(3) << "\n";
-    std::cout << "    [COMP] " << opr_type_str << "\n\n";
-    std::cout << "    [Right]\n";
-    if (right->getType() == Expression::ExpressionType::LITERAL) 
-        std::cout << "      " << right->print(3) << "\n";
-    else
-        std::cout << right->print(3) << "\n";
-    std::cout << "  }\n";
+    // 0 - factor
+    expr_operands.push_back(
+        makeArithExpr(left, right, Expression::ExpressionType::MINUS));
 }
 }
@@ -2,10 +2,20 @@
 #define __PARSER_HH__
 
 #include "lexer/lexer.hh"
+#include "lexer/pipe.hh"
+#include "parser/arena.hh"
+#include "parser/cache.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
 
 namespace Frontend
@@ -66,7 +76,7 @@ class ValueType
         }
     }
 
-    static Type strToValueType(std::string _type)
+    static Type strToValueType(std::string_view _type)
     {
         if (_type == "void")
             return ValueType::Type::VOID;
@@ -79,6 +89,27 @@ class ValueType
     }
 };
 
+// Variables in scope while the parser is inside a function, with their
+// types
+using VarMap = std::unordered_map<Symbol, ValueType::Type>;
+
+// A variable of a function, as numbered by the semantic pass
+// (parser/sema.hh) - arguments first, then locals in declaration order
+struct LocalSlot
+{
+    Symbol sym;
+    ValueType::Type type;
+};
+
+// Slot of an identifier that is not (yet) resolved to a variable
+constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+// Builds a std::visit visitor out of one lambda per alternative
+template <typename... Ts>
+struct Overloaded : Ts... { using Ts::operator()...; };
+template <typename... Ts>
+Overloaded(Ts...) -> Overloaded<Ts...>;
+
 /* Identifier definition */
 class Identifier
 {
@@ -86,119 +117,94 @@ class Identifier
     Token tok;
 
   public:
-    Identifier(const Identifier &_iden) : tok(_iden.tok) {}
-
     Identifier(Token &_tok) : tok(_tok) {}
 
-    virtual std::string print()
-    {
-        return tok.getLiteral();
-    }
-
-    auto &getLiteral() { return tok.getLiteral(); }
+    auto getLiteral() { return tok.getLiteral(); }
+    auto getSymbol() { return tok.getSymbol(); }
     auto getType() { return tok.prinTokenType(); }
 };
 
-/* Expression definition */
-class Expression
-{
-  public:
-    enum class ExpressionType : int
-    {
-        LITERAL, // i.e., 1
-        ARRAY,
-        INDEX,
+class Expression;
+class Statement;
+class Condition;
 
-        PLUS, // i.e., 1 + 2
-        MINUS, // i.e., 1 - 2
-        ASTERISK, // i.e., 1 * 2
-        SLASH, // i.e., 1 / 2
-
-        CALL,
-
-        ILLEGAL
-    };
-
-  protected:
-    ExpressionType type = ExpressionType::ILLEGAL;
-    
-  public:
-    Expression() {}
+enum class ExpressionType : int
+{
+    LITERAL, // i.e., 1
+    ARRAY,
+    INDEX,
 
-    auto getType() { return type; }
+    PLUS, // i.e., 1 + 2
+    MINUS, // i.e., 1 - 2
+    ASTERISK, // i.e., 1 * 2
+    SLASH, // i.e., 1 / 2
 
-    virtual std::string print(unsigned level) { return "[Error] No implementation"; }
+    CALL,
 
-    bool isExprLiteral() { return type == ExpressionType::LITERAL; }
-    bool isExprArray() { return type == ExpressionType::ARRAY; }
-    bool isExprIndex() { return type == ExpressionType::INDEX; }
-    bool isExprCall() { return type == ExpressionType::CALL; }
-    bool isExprArith()
-    {
-        return (type == ExpressionType::PLUS || 
-                type == ExpressionType::MINUS ||
-                type == ExpressionType::ASTERISK ||
-                type == ExpressionType::SLASH);
-    }
+    ILLEGAL
 };
 
-class LiteralExpression : public Expression
+/*
+ * Expression nodes.
+ *
+ * Each kind is a plain class; Expression (below) holds exactly one of
+ * them in a std::variant. Children are Expression pointers into the
+ * Program's arena and child lists are arena spans, so every node is
+ * trivially destructible.
+ *
+ * The AST cache (parser/cache.hh) saves these nodes, and the statement
+ * nodes below, byte for byte. Its key already changes with the layout
+ * of the nodes and with any edit to this header or lexer/lexer.hh.
+ * Bump ASTCache::FORMAT_VERSION by hand for what it cannot see: a change
+ * in what a member holds that keeps its type, such as how the semantic
+ * pass numbers slots or what fold.cc leaves in the tree, or a node that
+ * starts pointing at data outside the arena.
+ * */
+class LiteralExpression
 {
   protected:
     Token tok;
+
+    // variable an identifier refers to, set by the semantic pass
+    uint32_t slot = NO_SLOT;
     
   public:
-    LiteralExpression(const LiteralExpression &_expr) 
-    {
-        tok = _expr.tok;
-        type = ExpressionType::LITERAL;
-    }
+    LiteralExpression(Token &_tok) : tok(_tok) {}
 
-    LiteralExpression(Token &_tok) : tok(_tok) 
-    {
-        type = ExpressionType::LITERAL;
-    }
+    std::string_view getLiteral() { return tok.getLiteral(); }
+    Symbol getSymbol() { return tok.getSymbol(); }
+    bool isVariable() { return tok.isTokenIden(); }
+
+    auto getSlot() { return slot; }
+    void setSlot(uint32_t _slot) { slot = _slot; }
 
-    std::string& getLiteral() { return tok.getLiteral(); }
+    // Literal values are parsed once by the lexer
+    auto getInt() { return tok.getInt(); }
+    auto getFloat() { return tok.getFloat(); }
 
     bool isLiteralInt() { return tok.isTokenInt(); }
     bool isLiteralFloat() { return tok.isTokenFloat(); }
-
-    // Debug print associated with the print in ArithExp
-    std::string print(unsigned level) override
-    {
-        return (tok.getLiteral() + "\n");
-    }
 };
 
-class ArithExpression : public Expression
+class ArithExpression
 {
   protected:
-    // Unique is also good but it will incur errors when
-    // invoking copy constructors
-    std::shared_ptr<Expression> left;
-    std::shared_ptr<Expression> right;
+    Expression *left;
+    Expression *right;
+    ExpressionType type;
 
   public:
-    // unique can be easily converted to shared
-    ArithExpression(std::unique_ptr<Expression> &_left,
-                    std::unique_ptr<Expression> &_right,
+    ArithExpression(Expression *_left,
+                    Expression *_right,
                     ExpressionType _type)
-    {
-        left = std::move(_left);
-        right = std::move(_right);
-        type = _type;
-    }
-
-    ArithExpression(const ArithExpression &_expr)
-    {
-        left = std::move(_expr.left);
-        right = std::move(_expr.right);
-        type = _expr.type;
-    }
+        : left(_left)
+        , right(_right)
+        , type(_type)
+    {}
 
-    auto getLeft() { return left.get(); }
-    auto getRight() { return right.get(); }
+    auto getLeft() { return left; }
+    auto getRight() { return right; }
+    auto getType() { return type; }
 
     char getOperator()
     {
@@ -216,423 +222,252 @@ class ArithExpression : public Expression
                 assert(false && "unsupported operator");
         }
     }
-
-    // Debug print
-    std::string print(unsigned level) override
-    {
-        std::string prefix(level * 2, ' ');
-
-        std::string ret = "";
-        if (left != nullptr)
-        {
-            if (left->getType() == ExpressionType::LITERAL)
-            {
-                ret += prefix;
-            }
-
-            if (left->getType() == ExpressionType::CALL)
-                ret += left->print(level);
-            else
-                ret += left->print(level + 1);
-        }
-        
-        if (right != nullptr)
-        {
-            ret += prefix;
-            if (type == ExpressionType::PLUS)
-            {
-                ret += "+";
-            }
-            else if (type == ExpressionType::MINUS)
-            {
-                ret += "-";
-            }
-            else if (type == ExpressionType::ASTERISK)
-            {
-                ret += "*";
-            }
-            else if (type == ExpressionType::SLASH)
-            {
-                ret += "/";
-            }
-            ret += "\n";
-            
-            if (right->getType() == ExpressionType::LITERAL) 
-            {
-                ret += prefix;
-            }
-
-            if (right->getType() == ExpressionType::CALL)
-                ret += right->print(level);
-            else
-                ret += right->print(level + 1);
-        }
-         
-        return ret;
-    }
 };
 
-class ArrayExpression : public Expression
+class ArrayExpression
 {
   protected:
-    std::shared_ptr<Expression> num_ele;
-    std::vector<std::shared_ptr<Expression>> eles;
+    Expression *num_ele;
+    ArenaSpan<Expression*> eles;
 
   public:
-    ArrayExpression(std::unique_ptr<Expression> &_num_ele,
-                    std::vector<std::shared_ptr<Expression>> &_eles)
-    {
-        num_ele = std::move(_num_ele);
-        eles = std::move(_eles);
-        type = ExpressionType::ARRAY;
-    }
-
-    ArrayExpression(const ArrayExpression &_expr)
-    {
-        num_ele = std::move(_expr.num_ele);
-        eles = std::move(_expr.eles);
-        type = _expr.type;
-    }
+    ArrayExpression(Expression *_num_ele,
+                    ArenaSpan<Expression*> _eles)
+        : num_ele(_num_ele)
+        , eles(_eles)
+    {}
    
-    auto getNumElements() { return num_ele.get(); }
+    auto getNumElements() { return num_ele; }
     auto &getElements() { return eles; }
-
-    std::string print(unsigned level) override
-    {
-        std::string prefix(level * 2, ' ');
-
-        std::string ret = prefix + "{\n";
-        ret += (prefix + "  [ARRAY] \n");
-        ret += (prefix + "  [NUM ELEMENTS]\n");
-        ret += (prefix + "  {\n");
-        if (num_ele->isExprLiteral())
-            ret += (prefix + "    ");
-        ret += num_ele->print(level + 2);
-        ret += (prefix + "  }\n");
-
-        ret += (prefix + "  [ELEMENTS]\n");
-        ret += (prefix + "  {\n");
-        for (auto &ele : eles)
-        {
-            ret += (prefix + "    {\n");
-            if (ele->isExprLiteral())
-                ret += (prefix + "      ");
-            ret += ele->print(level + 3);
-            ret += (prefix + "    }\n");
-        }
-        ret += (prefix + "  }\n");
-	ret += (prefix + "}\n");
-        return ret;
-    }
-
 };
 
-class IndexExpression : public Expression
+class IndexExpression
 {
   protected:
-    std::shared_ptr<Identifier> iden;
-    std::shared_ptr<Expression> idx;
-
-  public:
-    IndexExpression(std::unique_ptr<Identifier> &_iden,
-                    std::unique_ptr<Expression> &_idx)
-    {
-        type = ExpressionType::INDEX;
-
-        iden = std::move(_iden);
-        idx = std::move(_idx);
-    }
+    Identifier *iden;
+    Expression *idx;
 
-    auto &getIden() { return iden->getLiteral(); }
-    auto getIndex() { return idx.get(); }
+    // the array, set by the semantic pass
+    uint32_t slot = NO_SLOT;
 
-    IndexExpression(const IndexExpression& _expr)
-    {
-        type = ExpressionType::INDEX;
+  public:
+    IndexExpression(Identifier *_iden,
+                    Expression *_idx)
+        : iden(_iden)
+        , idx(_idx)
+    {}
 
-        iden = std::move(_expr.iden);
-        idx = std::move(_expr.idx);
-    }
-    
-    std::string print(unsigned level) override
-    {
-        std::string prefix(level * 2, ' ');
-
-        std::string ret = prefix + "{\n";
-        ret += (prefix + "  [ARRAY] " + iden->getLiteral() + "\n");
-        ret += (prefix + "  [INDEX]\n");
-        ret += (prefix + "  {\n");
-        if (idx->isExprLiteral())
-            ret += (prefix + "      ");
-        ret += idx->print(level + 3);
-        ret += (prefix + "  }\n");
-	ret += (prefix + "}\n");
-        return ret;
+    auto getIden() { return iden->getLiteral(); }
+    auto getIdenSymbol() { return iden->getSymbol(); }
+    auto getIndex() { return idx; }
 
-    }
-    
+    auto getSlot() { return slot; }
+    void setSlot(uint32_t _slot) { slot = _slot; }
 };
 
-class CallExpression : public Expression
+class CallExpression
 {
   protected:
-    std::shared_ptr<Identifier> def;
-    std::vector<std::shared_ptr<Expression>> args;
+    Identifier *def;
+    ArenaSpan<Expression*> args;
 
   public:
-    CallExpression(const CallExpression &_expr) 
-    {
-        def = std::move(_expr.def);
-        args = std::move(_expr.args);
-        type = ExpressionType::CALL;
-    }
-
-    CallExpression(std::unique_ptr<Identifier> &_tok, 
-        std::vector<std::shared_ptr<Expression>>_args) 
-        : def(std::move(_tok))
-        , args(std::move(_args))
-    {
-        type = ExpressionType::CALL;
-    }
-
-    // Debug print associated with the print in ArithExp
-    std::string print(unsigned level) override
-    {
-        std::string prefix(level * 2, ' ');
-
-        std::string ret = prefix + "{\n";
-        ret += (prefix + "  [CALL] " + def->getLiteral() + "\n");
-        unsigned idx = 0;
-        for (auto &arg : args)
-        {
-            ret += (prefix + "  [ARG " + std::to_string(idx++) + "]\n");
-            ret += (prefix + "  {\n");
-            if (arg->getType() == Expression::ExpressionType::LITERAL)
-                ret += (prefix + "    ");
-            ret += arg->print(level + 2);
-            ret += (prefix + "  }\n");
-        }
-
-	ret += (prefix + "}\n");
-        return ret;
-    }
+    CallExpression(Identifier *_tok, 
+                   ArenaSpan<Expression*> _args) 
+        : def(_tok)
+        , args(_args)
+    {}
 
-    auto &getCallFunc() { return def->getLiteral(); }
+    auto getCallFunc() { return def->getLiteral(); }
+    auto getCallFuncSymbol() { return def->getSymbol(); }
     auto &getArgs() { return args; }
 };
 
-/* Statement definition*/
-class Statement
+/* Expression definition */
+class Expression
 {
   public:
-    enum class StatementType : int
-    {
-        ASSN_STATEMENT,
-        FUNC_STATEMENT,
-        RET_STATEMENT,
-        BUILT_IN_CALL_STATEMENT,
-        NORMAL_CALL_STATEMENT,
-        IF_STATEMENT,
-        FOR_STATEMENT,
-        WHILE_STATEMENT,
-        ILLEGAL
-    };
+    using ExpressionType = Frontend::ExpressionType;
+
+    // The closed set of expression kinds
+    using Node = std::variant<LiteralExpression,
+                              ArithExpression,
+                              ArrayExpression,
+                              IndexExpression,
+                              CallExpression>;
 
   protected:
-    StatementType type = StatementType::ILLEGAL;
+    Node node;
+
+    // type of the value, set by the semantic pass
+    ValueType::Type val_type = ValueType::Type::MAX;
 
   public:
-    Statement() {}
+    template <typename T, typename... Args>
+    Expression(std::in_place_type_t<T> kind, Args&&... args)
+        : node(kind, std::forward<Args>(args)...)
+    {}
 
-    virtual void printStatement() {}
+    auto getValueType() { return val_type; }
+    void setValueType(ValueType::Type _val_type) { val_type = _val_type; }
 
-    bool isStatementFunc() { return type == StatementType::FUNC_STATEMENT; }
-    bool isStatementAssn() { return type == StatementType::ASSN_STATEMENT; }
-    bool isStatementRet() { return type == StatementType::RET_STATEMENT; }
-    bool isStatementBuiltinCall() 
+    // Call vis with the concrete node, vis must accept every kind
+    template <typename Visitor>
+    decltype(auto) visit(Visitor &&vis)
     {
-        return type == StatementType::BUILT_IN_CALL_STATEMENT; 
+        return std::visit(std::forward<Visitor>(vis), node);
     }
-    bool isStatementNormalCall()
+
+    // The node as a T, nullptr if it is another kind
+    template <typename T>
+    T* as() { return std::get_if<T>(&node); }
+
+    ExpressionType getType()
     {
-        return type == StatementType::NORMAL_CALL_STATEMENT;
+        return visit(Overloaded{
+            [](LiteralExpression&) { return ExpressionType::LITERAL; },
+            [](ArithExpression &arith) { return arith.getType(); },
+            [](ArrayExpression&) { return ExpressionType::ARRAY; },
+            [](IndexExpression&) { return ExpressionType::INDEX; },
+            [](CallExpression&) { return ExpressionType::CALL; }
+        });
     }
-    bool isStatementIf() { return type == StatementType::IF_STATEMENT; }
-    bool isStatementFor() { return type == StatementType::FOR_STATEMENT; }
-    bool isStatementWhile() { return type == StatementType::WHILE_STATEMENT; }
+
+    bool isExprLiteral() { return std::holds_alternative<LiteralExpression>(node); }
+    bool isExprArray() { return std::holds_alternative<ArrayExpression>(node); }
+    bool isExprIndex() { return std::holds_alternative<IndexExpression>(node); }
+    bool isExprCall() { return std::holds_alternative<CallExpression>(node); }
+    bool isExprArith() { return std::holds_alternative<ArithExpression>(node); }
+};
+
+enum class StatementType : int
+{
+    ASSN_STATEMENT,
+    FUNC_STATEMENT,
+    RET_STATEMENT,
+    BUILT_IN_CALL_STATEMENT,
+    NORMAL_CALL_STATEMENT,
+    IF_STATEMENT,
+    FOR_STATEMENT,
+    WHILE_STATEMENT,
+    ILLEGAL
 };
 
-class AssnStatement : public Statement
+/*
+ * Statement nodes, held by Statement the same way. Blocks are arena
+ * spans; the variables of a whole function are one slot table on its
+ * FuncStatement.
+ * */
+class AssnStatement
 {
   protected:
-    // using shared due to copy constructors
-    std::shared_ptr<Expression> iden;
-    std::shared_ptr<Expression> expr;
+    Expression *iden;
+    Expression *expr;
 
-  public:
-    AssnStatement(std::unique_ptr<Expression> &_iden,
-                 std::unique_ptr<Expression> &_expr)
-    {
-        type = StatementType::ASSN_STATEMENT;
+    // declared type for "int x = ...", MAX for a plain assignment
+    ValueType::Type decl_type;
 
-        iden = std::move(_iden);
-        expr = std::move(_expr);
-    }
-    
-    AssnStatement(const AssnStatement &_statement)
-    {
-        iden = std::move(_statement.iden);
-        expr = std::move(_statement.expr);
-        type = _statement.type;
-    }
+  public:
+    AssnStatement(Expression *_iden,
+                  Expression *_expr,
+                  ValueType::Type _decl_type = ValueType::Type::MAX)
+        : iden(_iden)
+        , expr(_expr)
+        , decl_type(_decl_type)
+    {}
 
-    auto getIden() { return iden.get(); }
-    auto getExpr() { return expr.get(); }
+    auto getIden() { return iden; }
+    auto getExpr() { return expr; }
 
-    void printStatement() override;
+    bool isDecl() { return decl_type != ValueType::Type::MAX; }
+    auto getDeclType() { return decl_type; }
 };
 
-class FuncStatement : public Statement
+class FuncStatement
 {
   public:
     class Argument
     {
       protected:
         ValueType::Type type = ValueType::Type::MAX;
-        std::shared_ptr<Identifier> iden;
+        Identifier *iden;
 
       public:
-        Argument(std::string &_type, std::unique_ptr<Identifier> &_iden)
+        Argument(std::string_view _type, Identifier *_iden)
+            : iden(_iden)
         {
             type = ValueType::strToValueType(_type);
 
             assert(type != ValueType::Type::MAX);
-
-            iden = std::move(_iden);
-        }
-
-        Argument(const Argument &arg)
-        {
-            type = arg.type;
-            iden = std::move(arg.iden);
         }
 
-        std::string print()
-        {
-            std::string ret = "";
-            if (type == ValueType::Type::INT) ret += "int : ";
-            else if (type == ValueType::Type::FLOAT) ret += "float : ";
-
-            ret += iden->getLiteral();
-
-            return ret;
-        }
-
-        std::string &getLiteral() { return iden->getLiteral(); }
+        std::string_view getLiteral() { return iden->getLiteral(); }
+        auto getSymbol() { return iden->getSymbol(); }
         auto getArgType() { return type; }
     };
 
   protected:
-    // using shared due to copy constructors
     ValueType::Type func_type;
-    std::shared_ptr<Identifier> iden;
-    std::vector<Argument> args;
-    std::vector<std::shared_ptr<Statement>> codes;
+    Identifier *iden;
+    ArenaSpan<Argument> args;
+    ArenaSpan<Statement*> codes;
 
-    std::unordered_map<std::string, ValueType::Type> local_vars;
+    // every variable, indexed by slot, set by the semantic pass
+    ArenaSpan<LocalSlot> slots;
 
   public:
     FuncStatement(ValueType::Type _type,
-                  std::unique_ptr<Identifier> &_iden,
-                  std::vector<Argument> &_args,
-                  std::vector<std::shared_ptr<Statement>> &_codes,
-                  std::unordered_map<std::string,ValueType::Type> &_local_vars)
-    {
-        type = StatementType::FUNC_STATEMENT;
-
-        func_type = _type;
-        iden = std::move(_iden);
-        args = _args;
-        codes = std::move(_codes);
-        local_vars = _local_vars;
-    }
-    
-    FuncStatement(const FuncStatement &_statement)
-    {
-        type = _statement.type;
-
-        func_type = _statement.func_type;
-        iden = std::move(_statement.iden);
-        args = _statement.args;
-        codes = std::move(_statement.codes);
-        local_vars = _statement.local_vars;
-    }
+                  Identifier *_iden,
+                  ArenaSpan<Argument> _args,
+                  ArenaSpan<Statement*> _codes)
+        : func_type(_type)
+        , iden(_iden)
+        , args(_args)
+        , codes(_codes)
+    {}
   
-    auto getLocalVars() {return &local_vars; }
+    auto &getSlots() { return slots; }
+    void setSlots(ArenaSpan<LocalSlot> _slots) { slots = _slots; }
 
     auto getRetType() { return func_type; }
 
-    auto &getFuncName() { return iden->getLiteral(); }
+    auto getFuncName() { return iden->getLiteral(); }
+    auto getFuncSymbol() { return iden->getSymbol(); }
     auto &getFuncArgs() { return args; }
     auto &getFuncCodes() { return codes; }
-
-    void printStatement() override;
 };
 
-class CallStatement : public Statement
+class CallStatement
 {
   protected:
-    std::shared_ptr<Expression> expr;
+    Expression *expr;
+
+    // BUILT_IN_CALL_STATEMENT or NORMAL_CALL_STATEMENT
+    StatementType type;
 
   public:
-    CallStatement(std::unique_ptr<Expression> &_expr,
+    CallStatement(Expression *_expr,
                   StatementType _type)
-    {
-        type = _type;
-
-        expr = std::move(_expr);
-    }
-    
-    CallStatement(const CallStatement &_statement)
-    {
-        type = _statement.type;
+        : expr(_expr)
+        , type(_type)
+    {}
 
-        expr = std::move(_statement.expr);
-    }
-    
-    void printStatement() override
-    {
-        std::cout << expr->print(2);
-    }
+    auto getType() { return type; }
+    bool isBuiltIn() { return type == StatementType::BUILT_IN_CALL_STATEMENT; }
 
-    CallExpression* getCallExpr()
-    {
-        CallExpression *call = 
-            static_cast<CallExpression*>(expr.get());
-        return call;
-    }
+    Expression* getExpr() { return expr; }
+    CallExpression* getCallExpr() { return expr->as<CallExpression>(); }
 };
 
-class RetStatement : public Statement
+class RetStatement
 {
   protected:
-    std::shared_ptr<Expression> ret;
+    Expression *ret;
 
   public:
-    RetStatement(std::unique_ptr<Expression> &_ret) : ret(std::move(_ret))
-    {
-        type = StatementType::RET_STATEMENT;
-    }
-
-    RetStatement(const RetStatement &_statement)
-    {
-        type = _statement.type;
-        ret = std::move(_statement.ret);
-    }
-
-    auto getRetVal() { return ret.get(); }
+    RetStatement(Expression *_ret) : ret(_ret) {}
 
-    void printStatement() override;
+    auto getRetVal() { return ret; }
 };
 
 // For if-else and for loop
@@ -648,20 +483,18 @@ class Condition
         EQ, NE, GT, GE, LT, LE, MAX
     };
     OperatorType opr_type = OperatorType::MAX;
-    std::string opr_type_str;
 
-    std::shared_ptr<Expression> left;
-    std::shared_ptr<Expression> right;
+    Expression *left;
+    Expression *right;
 
   public:
-    Condition(std::unique_ptr<Expression> &_left,
-              std::unique_ptr<Expression> &_right,
+    Condition(Expression *_left,
+              Expression *_right,
               std::string &_opr_type_str,
               ValueType::Type _comp_type)
+        : left(_left)
+        , right(_right)
     {
-        left = std::move(_left);
-        right = std::move(_right);
-
         if (_opr_type_str == "==")
             opr_type = OperatorType::EQ;
         else if (_opr_type_str == "!=")
@@ -677,170 +510,178 @@ class Condition
         else
             assert(false);
 
-        opr_type_str = _opr_type_str;
-
         comp_type = _comp_type; 
     }
 
-    Condition(const Condition& _cond)
-        : left(std::move(_cond.left))
-        , right(std::move(_cond.right))
-        , opr_type_str(_cond.opr_type_str)
-        , comp_type(_cond.comp_type)
-    {}
-
     auto getType() { return comp_type; }
-    auto &getOpr() { return opr_type_str; }
-    auto getLeft() { return left.get(); }
-    auto getRight() { return right.get(); }
-
-    void printStatement();
+    std::string_view getOpr()
+    {
+        switch (opr_type)
+        {
+            case OperatorType::EQ: return "==";
+            case OperatorType::NE: return "!=";
+            case OperatorType::GT: return ">";
+            case OperatorType::GE: return ">=";
+            case OperatorType::LT: return "<";
+            case OperatorType::LE: return "<=";
+            default: return "";
+        }
+    }
+    auto getLeft() { return left; }
+    auto getRight() { return right; }
 };
 
-class IfStatement : public Statement
+class IfStatement
 {    
   protected:
-    std::shared_ptr<Condition> cond;
-    std::vector<std::shared_ptr<Statement>> taken_block;
-    std::vector<std::shared_ptr<Statement>> not_taken_block;
-
-    std::unordered_map<std::string, ValueType::Type> taken_local_vars;
-    std::unordered_map<std::string, ValueType::Type> not_taken_local_vars;
+    Condition *cond;
+    ArenaSpan<Statement*> taken_block;
+    ArenaSpan<Statement*> not_taken_block;
 
   public:
 
-    IfStatement(std::unique_ptr<Condition> &_cond,
-                std::vector<std::shared_ptr<Statement>> &_taken_block,
-                std::vector<std::shared_ptr<Statement>> &_not_taken_block,
-                std::unordered_map<std::string, 
-                                   ValueType::Type> &_taken_local_vars,
-                std::unordered_map<std::string, 
-                                   ValueType::Type> &_not_taken_local_vars)
-    {
-        type = StatementType::IF_STATEMENT;
-
-        cond = std::move(_cond);
-        taken_block = std::move(_taken_block);
-        not_taken_block = std::move(_not_taken_block);
-
-        taken_local_vars = _taken_local_vars;
-        not_taken_local_vars = _not_taken_local_vars;
-    }
-
-    IfStatement(const IfStatement &_if)
-        : cond(std::move(_if.cond))
-        , taken_block(std::move(_if.taken_block))
-        , not_taken_block(std::move(_if.not_taken_block))
-        , taken_local_vars(_if.taken_local_vars)
-        , not_taken_local_vars(_if.not_taken_local_vars)
+    IfStatement(Condition *_cond,
+                ArenaSpan<Statement*> _taken_block,
+                ArenaSpan<Statement*> _not_taken_block)
+        : cond(_cond)
+        , taken_block(_taken_block)
+        , not_taken_block(_not_taken_block)
     {}
 
-    auto getCond() { return cond.get(); }
+    auto getCond() { return cond; }
     auto &getTakenBlock() { return taken_block; }
     auto &getNotTakenBlock() { return not_taken_block; }
-    auto getTakenBlockVars() { return &taken_local_vars; }
-    auto getNotTakenBlockVars() { return &not_taken_local_vars; }
-
-    void printStatement() override;
 };
 
-class WhileStatement : public Statement
+class WhileStatement
 {
   protected:
-    std::shared_ptr<Condition> end;
-    std::vector<std::shared_ptr<Statement>> block;
-    std::unordered_map<std::string, ValueType::Type> block_local_vars;
+    Condition *end;
+    ArenaSpan<Statement*> block;
   public:
 
-    WhileStatement(std::unique_ptr<Condition> &_end,
-                   std::vector<std::shared_ptr<Statement>> &_block,
-                   std::unordered_map<std::string, ValueType::Type> &_block_local_vars)
-    {
-        type = StatementType::WHILE_STATEMENT;
-        end = std::move(_end);
-        block = std::move(_block);
-        block_local_vars = _block_local_vars;
-    }
-
-    WhileStatement(const WhileStatement &_while)
-        : end(std::move(_while.end))
-        , block(std::move(_while.block))
-        , block_local_vars(_while.block_local_vars)
+    WhileStatement(Condition *_end,
+                   ArenaSpan<Statement*> _block)
+        : end(_end)
+        , block(_block)
     {}
 
-    auto getEnd() { return end.get(); }
+    auto getEnd() { return end; }
     auto &getBlock() { return block; }
-    auto getBlockVars() { return &block_local_vars; }
-
-    void printStatement() override;
 };
 
-class ForStatement : public Statement
+class ForStatement
 {    
   protected:
-    std::shared_ptr<Statement> start;
-    std::shared_ptr<Condition> end;
-    std::shared_ptr<Statement> step;
-    std::vector<std::shared_ptr<Statement>> block;
+    Statement *start;
+    Condition *end;
+    Statement *step;
+    ArenaSpan<Statement*> block;
 
-    std::unordered_map<std::string, ValueType::Type> block_local_vars;
+  public:
+
+    ForStatement(Statement *_start,
+                 Condition *_end,
+                 Statement *_step,
+                 ArenaSpan<Statement*> _block)
+        : start(_start)
+        , end(_end)
+        , step(_step)
+        , block(_block)
+    {}
 
+    auto getStart() { return start; }
+    auto getEnd() { return end; }
+    auto getStep() { return step; }
+    auto &getBlock() { return block; }
+};
+
+/* Statement definition*/
+class Statement
+{
   public:
+    using StatementType = Frontend::StatementType;
 
-    ForStatement(std::unique_ptr<Statement> &_start,
-                 std::unique_ptr<Condition> &_end,
-                 std::unique_ptr<Statement> &_step,
-                 std::vector<std::shared_ptr<Statement>> &_block,
-                 std::unordered_map<std::string, 
-                                    ValueType::Type> &_block_local_vars)
-    {
-        type = StatementType::FOR_STATEMENT;
-        
-        start = std::move(_start);
-        end = std::move(_end);
-        step = std::move(_step);
-        block = std::move(_block);
+    // The closed set of statement kinds
+    using Node = std::variant<AssnStatement,
+                              FuncStatement,
+                              CallStatement,
+                              RetStatement,
+                              IfStatement,
+                              ForStatement,
+                              WhileStatement>;
 
-        block_local_vars = _block_local_vars;
-    }
+  protected:
+    Node node;
 
-    ForStatement(const ForStatement &_for)
-        : start(std::move(_for.start))
-        , end(std::move(_for.end))
-        , step(std::move(_for.step))
-        , block(std::move(_for.block))
-        , block_local_vars(_for.block_local_vars)
+  public:
+    template <typename T, typename... Args>
+    Statement(std::in_place_type_t<T> kind, Args&&... args)
+        : node(kind, std::forward<Args>(args)...)
     {}
 
-    auto getStart() { return start.get(); }
-    auto getEnd() { return end.get(); }
-    auto getStep() { return step.get(); }
-    auto &getBlock() { return block; }
-    auto getBlockVars() { return &block_local_vars; }
+    // Call vis with the concrete node, vis must accept every kind
+    template <typename Visitor>
+    decltype(auto) visit(Visitor &&vis)
+    {
+        return std::visit(std::forward<Visitor>(vis), node);
+    }
 
-    void printStatement() override;
+    // The node as a T, nullptr if it is another kind
+    template <typename T>
+    T* as() { return std::get_if<T>(&node); }
+
+    bool isStatementFunc() { return std::holds_alternative<FuncStatement>(node); }
+    bool isStatementAssn() { return std::holds_alternative<AssnStatement>(node); }
+    bool isStatementRet() { return std::holds_alternative<RetStatement>(node); }
+    bool isStatementBuiltinCall() 
+    {
+        auto call = as<CallStatement>();
+        return call != nullptr && call->isBuiltIn();
+    }
+    bool isStatementNormalCall()
+    {
+        auto call = as<CallStatement>();
+        return call != nullptr && !call->isBuiltIn();
+    }
+    bool isStatementIf() { return std::holds_alternative<IfStatement>(node); }
+    bool isStatementFor() { return std::holds_alternative<ForStatement>(node); }
+    bool isStatementWhile() { return std::holds_alternative<WhileStatement>(node); }
 };
 
+static_assert(std::is_trivially_destructible_v<Expression> &&
+              std::is_trivially_destructible_v<Statement> &&
+              std::is_trivially_destructible_v<Condition>,
+              "AST nodes are never destroyed one by one");
+
 /* Program definition */
 class Program
 {
   protected:
-    std::vector<std::unique_ptr<Statement>> statements;
+    // Every node of the tree, freed in one go with the Program
+    Arena arena;
+
+    std::vector<Statement*> statements;
 
   public:
     Program() {}
 
-    void addStatement(std::unique_ptr<Statement> &_statement)
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
     {
-        statements.push_back(std::move(_statement));
+        return arena.make<T>(std::forward<Args>(args)...);
     }
 
-    void printStatements()
+    void addStatement(Statement *_statement)
     {
-        for (auto &statement : statements) { statement->printStatement(); }
+        statements.push_back(_statement);
     }
 
+    // Dump the tree (implemented in printer.cc)
+    void printStatements(std::ostream &out = std::cout);
+
     auto& getStatements() { return statements; }
+    auto& getArena() { return arena; }
 };
 
 /* Parser definition */
@@ -849,9 +690,153 @@ class Parser
   protected:
     Program program;
 
+    // Arena-allocated expression/statement holding a T
+    template <typename T, typename... Args>
+    Expression* makeExpr(Args&&... args)
+    {
+        return program.make<Expression>(std::in_place_type<T>,
+                                        std::forward<Args>(args)...);
+    }
+
+    template <typename T, typename... Args>
+    Statement* makeStatement(Args&&... args)
+    {
+        return program.make<Statement>(std::in_place_type<T>,
+                                       std::forward<Args>(args)...);
+    }
+
+    // Child list in the arena
+    template <typename T>
+    ArenaSpan<T> makeSpan(const std::vector<T> &elems)
+    {
+        return program.getArena().copy(elems);
+    }
+
+    // Hash-consing (share_exprs) - within a function, structurally equal
+    // side-effect-free expressions are built once and the node is shared,
+    // which makes each expression tree a DAG. Numbers are keyed by their
+    // text, variables by their declaration (a later variable of the same
+    // name, in another block, gets nodes of its own), everything else by
+    // its operator and the (already shared) nodes under it. Calls and
+    // array initializers are never shared, nor is anything above a call.
+    struct ExprKey
+    {
+        ExpressionType kind;
+        // number text
+        std::string_view text;
+        // variable - symbol and declaration count, see varKey()
+        uint64_t var = 0;
+        Expression *left = nullptr;
+        Expression *right = nullptr;
+
+        bool operator==(const ExprKey &other) const
+        {
+            return kind == other.kind && text == other.text &&
+                   var == other.var && left == other.left &&
+                   right == other.right;
+        }
+    };
+
+    struct ExprKeyHash
+    {
+        size_t operator()(const ExprKey &key) const
+        {
+            size_t seed = std::hash<std::string_view>()(key.text);
+            for (uint64_t word : {(uint64_t)key.kind, key.var,
+                                  (uint64_t)(uintptr_t)key.left,
+                                  (uint64_t)(uintptr_t)key.right})
+            {
+                seed ^= word + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+            }
+            return seed;
+        }
+    };
+
+    bool share_exprs = false;
+    std::unordered_map<ExprKey, Expression*, ExprKeyHash> shared_exprs;
+    // Declarations of each name so far in the function
+    std::unordered_map<Symbol, uint32_t> num_decls;
+    // Expressions that were found in shared_exprs instead of built
+    size_t num_shared = 0;
+
+    uint64_t varKey(Symbol sym)
+    {
+        return ((uint64_t)sym << 32) | num_decls[sym];
+    }
+
+    // The node for key, built by build() unless there already is one
+    template <typename Build>
+    Expression* shareExpr(const ExprKey &key, Build build)
+    {
+        if (!share_exprs) return build();
+
+        if (auto iter = shared_exprs.find(key); iter != shared_exprs.end())
+        {
+            num_shared++;
+            return iter->second;
+        }
+        auto expr = build();
+        shared_exprs.emplace(key, expr);
+        return expr;
+    }
+
+    // Number or variable
+    Expression* makeLiteralExpr(Token &_tok)
+    {
+        ExprKey key{ExpressionType::LITERAL};
+        if (_tok.isTokenIden())
+            key.var = varKey(_tok.getSymbol());
+        else
+            key.text = _tok.getLiteral();
+
+        return shareExpr(key,
+            [&]() { return makeExpr<LiteralExpression>(_tok); });
+    }
+
+    Expression* makeArithExpr(Expression *left, Expression *right,
+                              ExpressionType opr)
+    {
+        auto build = [&]()
+                     { return makeExpr<ArithExpression>(left, right, opr); };
+
+        // A call node is never shared, nothing above one can match
+        if (left->isExprCall() || right->isExprCall()) return build();
+        return shareExpr(ExprKey{opr, {}, 0, left, right}, build);
+    }
+
   protected:
+    // All the tokens of the file, cur_token is tokens[tok_idx]. Body
+    // workers (parallel mode) read the buffer of the parser they came from
+    TokenBuffer token_buf;
+    const TokenBuffer *tokens = &token_buf;
+    size_t tok_idx = 0;
     Token cur_token;
-    Token next_token;    
+
+    // Pipelined mode - tokens arrive from the lexer thread instead, the
+    // ones already pulled in by peekToken() wait in lookahead
+    std::unique_ptr<TokenPipe> pipe;
+    std::deque<Token> lookahead;
+    LineTable line_table;
+
+    // Token k positions ahead of cur_token, EOF past the end
+    Token peekToken(size_t k = 1) 
+    { 
+        if (!pipe) return tokens->token(tok_idx + k);
+
+        while (lookahead.size() < k) lookahead.push_back(pipe->pop());
+        return lookahead[k - 1];
+    }
+
+    // "[Line <line>:<col>] <source line>" of cur_token (for error messages)
+    std::string curLocation()
+    {
+        auto loc = pipe ? line_table.locate(cur_token.getOffset()) :
+                          tokens->location(tok_idx);
+        auto line = pipe ? line_table.lineText(loc.line) : 
+                           tokens->line(tok_idx);
+        return "[Line " + std::to_string(loc.line) + ":" + 
+               std::to_string(loc.col) + "] " + std::string(line);
+    }
     
   /************* Section one - record local variable types ***************/
   protected:
@@ -861,25 +846,32 @@ class Parser
                ValueType::Type::MAX;
     }
 
-    // Track each local variable's type
-    // vector is needed because we need a way to distinguish vars inside
-    // if/else, for.
-    int entering_sub_block = 0;
-    std::vector<std::unordered_map<std::string,
-                                   ValueType::Type>*> local_vars_tracker;
+    // Track each local variable's type. A name can not be declared again
+    // while it is in scope, so one map holds the variables of all the
+    // open blocks (if/else, for, while); each block keeps the names it
+    // declared and drops them when it closes. Lookups cost the same at
+    // any nesting depth.
+    VarMap local_vars;
+    std::vector<std::vector<Symbol>> block_vars;
+
+    void openScope() { block_vars.emplace_back(); }
+    void closeScope()
+    {
+        for (auto sym : block_vars.back()) local_vars.erase(sym);
+        block_vars.pop_back();
+    }
+
     // recordLocalVars v1 - record the arguments
     void recordLocalVars(FuncStatement::Argument &arg,
                          bool is_array = false,
                          bool is_ptr = false)
     {
-        auto arg_name = arg.getLiteral();
+        auto arg_name = arg.getSymbol();
         auto arg_type = arg.getArgType();
         assert(arg_type != ValueType::Type::MAX);
 
-        auto &tracker = local_vars_tracker.back();
-
-        if (auto iter = tracker->find(arg_name);
-                iter != tracker->end())
+        if (auto iter = local_vars.find(arg_name);
+                iter != local_vars.end())
         {
             std::cerr << "[Error] recordLocalVars: "
                       << "duplicated variable definition."
@@ -888,7 +880,9 @@ class Parser
         }
         else
         {
-            tracker->insert({arg_name, arg_type});
+            local_vars.insert({arg_name, arg_type});
+            block_vars.back().push_back(arg_name);
+            if (share_exprs) num_decls[arg_name]++;
         }
     }
     // recordLocalVars v2 - record local variables
@@ -914,21 +908,16 @@ class Parser
         }
         
         // We should always allocate new variables to the most inner block
-        auto &tracker = local_vars_tracker.back();
-        tracker->insert({_tok.getLiteral(), var_type});
+        local_vars.insert({_tok.getSymbol(), var_type});
+        block_vars.back().push_back(_tok.getSymbol());
+        if (share_exprs) num_decls[_tok.getSymbol()]++;
     }
     std::pair<bool,ValueType::Type> isVarAlreadyDefined(Token &_tok)
     {
-        for (int i = local_vars_tracker.size() - 1;
-                 i >= 0;
-                 i--)
+        if (auto iter = local_vars.find(_tok.getSymbol());
+                iter != local_vars.end())
         {
-            auto &tracker = local_vars_tracker[i];
-            if (auto iter = tracker->find(_tok.getLiteral());
-                    iter != tracker->end())
-            {
-                return std::make_pair(true, iter->second);
-            }
+            return std::make_pair(true, iter->second);
         }
 
         return std::make_pair(false, ValueType::Type::MAX);
@@ -942,24 +931,37 @@ class Parser
 
         bool is_built_in = false;
 
+        // Definition order, a function only sees the ones defined
+        // before it (and itself)
+        size_t order = 0;
+
         FuncRecord() {}
 
         FuncRecord(const FuncRecord& _record)
             : ret_type(_record.ret_type)
             , arg_types(_record.arg_types)
             , is_built_in(_record.is_built_in)
+            , order(_record.order)
         {}
     };
-    std::unordered_map<std::string,FuncRecord> func_def_tracker;
-    void recordDefs(std::string &_def,
-                    ValueType::Type _type,
-                    std::vector<FuncStatement::Argument> &_args)
+    // Workers share the records of the parser they came from, read-only
+    std::unordered_map<Symbol,FuncRecord> func_defs;
+    std::unordered_map<Symbol,FuncRecord> *func_def_tracker = &func_defs;
+
+    // Order of the function being parsed
+    size_t cur_func_order = 0;
+
+    // Returns the definition order of the new record
+    size_t recordDefs(Symbol _def,
+                      ValueType::Type _type,
+                      std::vector<FuncStatement::Argument> &_args)
     {
-        auto iter = func_def_tracker.find(_def);
-        assert(iter == func_def_tracker.end() && "duplicated def");
+        auto iter = func_def_tracker->find(_def);
+        assert(iter == func_def_tracker->end() && "duplicated def");
 
         FuncRecord record;
         record.ret_type = _type;
+        record.order = func_def_tracker->size();
 
         auto &arg_types = record.arg_types;
         for (auto &arg : _args)
@@ -967,15 +969,29 @@ class Parser
             arg_types.push_back(arg.getArgType());
         }
         
-        func_def_tracker[_def] = record;
+        (*func_def_tracker)[_def] = record;
+        return record.order;
+    }
+
+    // Record of a function visible from the current one, nullptr if
+    // there is none
+    FuncRecord* findFuncDef(Symbol _def)
+    {
+        auto iter = func_def_tracker->find(_def);
+        if (iter == func_def_tracker->end() ||
+            iter->second.order > cur_func_order)
+        {
+            return nullptr;
+        }
+        return &iter->second;
     }
     
-    std::pair<bool,bool> isFuncDef(std::string &_def)
+    std::pair<bool,bool> isFuncDef(Symbol _def)
     {
-        if (auto iter = func_def_tracker.find(_def);
-                iter != func_def_tracker.end())
+        if (auto record = findFuncDef(_def);
+                record != nullptr)
         {
-            return std::make_pair(true, iter->second.is_built_in);
+            return std::make_pair(true, record->is_built_in);
         }
         else
         {
@@ -984,17 +1000,17 @@ class Parser
     }
 
   public:
-    auto& getFuncArgTypes(std::string &func_name)
+    auto& getFuncArgTypes(Symbol func_name)
     {
-        auto iter = func_def_tracker.find(func_name);
-        assert(iter != func_def_tracker.end());
+        auto iter = func_def_tracker->find(func_name);
+        assert(iter != func_def_tracker->end());
         return iter->second.arg_types;
     }
 
-    auto &getFuncRetType(std::string &_def)
+    auto &getFuncRetType(Symbol _def)
     {
-        auto iter = func_def_tracker.find(_def);
-        assert(iter != func_def_tracker.end());
+        auto iter = func_def_tracker->find(_def);
+        assert(iter != func_def_tracker->end());
 
         return iter->second.ret_type;
     }
@@ -1024,7 +1040,7 @@ class Parser
 
         std::cerr << "[Error] Token type of \"" << _tok.getLiteral()
                   << "\" inconsistent within expression" << std::endl;
-        std::cerr << "[Line] " << cur_token.getLine() << "\n";
+        std::cerr << curLocation() << "\n";
         exit(0);
     }
 
@@ -1036,25 +1052,18 @@ class Parser
         else tok_type = ValueType::Type::MAX;
 
         // If the token is a variable, we need extract its recorded type
-        for (int i = local_vars_tracker.size() - 1;
-                 i >= 0;
-                 i--)
+        if (auto iter = local_vars.find(_tok.getSymbol());
+                iter != local_vars.end())
         {
-            auto &tracker = local_vars_tracker[i];
-            if (auto iter = tracker->find(_tok.getLiteral());
-                    iter != tracker->end())
-            {
-                tok_type = iter->second;
-                break;
-            }
+            tok_type = iter->second;
         }
         
         // If the token is function name, we need to extract its
         // recorded type.
-        if (auto iter = func_def_tracker.find(_tok.getLiteral());
-                iter != func_def_tracker.end())
+        if (auto record = findFuncDef(_tok.getSymbol());
+                record != nullptr)
         {
-            tok_type = iter->second.ret_type;
+            tok_type = record->ret_type;
         }
         
         if (is_index_or_deref)
@@ -1068,44 +1077,161 @@ class Parser
        	if (tok_type == ValueType::Type::MAX)
         {
             std::cerr << "[Error] Token \"" << _tok.getLiteral() << "\" not defined!" << std::endl;
-            std::cerr << "[Line] " << cur_token.getLine() << "\n";
+            std::cerr << curLocation() << "\n";
             exit(0);
         }
 
         return tok_type;
     }
 
+  /************* Section three - binary operator table *******************/
+  protected:
+    // How a token combines two expressions. prec - higher binds tighter.
+    // Adding an operator is one more entry (and its ExpressionType), the
+    // expression parser itself is driven entirely by this table.
+    struct BinaryOperator
+    {
+        Token::TokenType tok_type;
+        ExpressionType expr_type;
+        unsigned prec;
+    };
+
+    static constexpr BinaryOperator binary_operators[] =
+    {
+        {Token::TokenType::TOKEN_PLUS, ExpressionType::PLUS, 1},
+        {Token::TokenType::TOKEN_MINUS, ExpressionType::MINUS, 1},
+        {Token::TokenType::TOKEN_ASTERISK, ExpressionType::ASTERISK, 2},
+        {Token::TokenType::TOKEN_SLASH, ExpressionType::SLASH, 2}
+    };
+
+    // nullptr if the token is not a binary operator
+    static const BinaryOperator* binaryOperator(Token &_tok)
+    {
+        for (auto &opr : binary_operators)
+        {
+            if (opr.tok_type == _tok.getTokenType()) return &opr;
+        }
+        return nullptr;
+    }
+
   protected:
     std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<ASTCache> cache;
 
-  public:
-    Parser(const char* fn); 
+    // Take the program from the cache, false on a miss
+    bool loadCached();
+    void storeCached();
 
-    void printStatements() { program.printStatements(); }
+  public:
+    // pipelined   - lex on a separate thread while parsing, otherwise the
+    //               whole file is lexed up front
+    // num_threads - lex, then parse the function bodies, on this many
+    //               threads (ignored when pipelined)
+    // cache_dir   - look the program up in this AST cache first, and save
+    //               it there after a miss (parser/cache.hh)
+    // share_exprs - hash-cons expressions into a DAG, see ExprKey
+    Parser(const char* fn, bool pipelined = false, unsigned num_threads = 1,
+           const char* cache_dir = nullptr, bool share_exprs = false); 
+
+    void printStatements(std::ostream &out = std::cout) 
+    { 
+        program.printStatements(out); 
+    }
 
     auto &getProgram() { return program; }
 
+    // Identifier names behind the symbols in the AST
+    auto &getSymbols() { return lexer->getSymbols(); }
+
+    // nullptr unless constructed with a cache_dir
+    ASTCache* getCache() { return cache.get(); }
+
+    // Expressions shared instead of built (0 when taken from the cache)
+    size_t numShared() const { return num_shared; }
+
   protected:
+    // Body worker, shares parent's tokens and function records
+    Parser(Parser &parent);
+
+    // A function up to its body
+    struct FuncSignature
+    {
+        ValueType::Type ret_type;
+        Identifier *iden = nullptr;
+        std::vector<FuncStatement::Argument> args;
+
+        size_t order = 0;
+        // Token index of the "{" that opens the body
+        size_t body_begin = 0;
+    };
+
     void parseProgram();
+    void parseProgramParallel(unsigned num_threads);
+    FuncSignature parseSignature();
+    Statement* parseFuncBody(FuncSignature&);
+    void skipBlock();
     void advanceTokens();
 
-    void parseStatement(std::string&,
-                        std::vector<std::shared_ptr<Statement>>&);
-    std::unique_ptr<Statement> parseAssnStatement();
+    // A block being parsed - the function body, or the block of an
+    // if/else, for or while along with the rest of that statement
+    struct OpenBlock
+    {
+        StatementType kind;
+        std::vector<Statement*> codes;
+
+        Condition *cond = nullptr;
+        // for
+        Statement *start = nullptr;
+        Statement *step = nullptr;
+        // if, the taken block once codes is the else block
+        bool in_else = false;
+        std::vector<Statement*> taken;
+    };
+
+    void parseBlocks(Symbol, std::vector<Statement*>&);
+    bool closeBlock(std::vector<OpenBlock>&);
+
+    void parseStatement(Symbol,
+                        std::vector<Statement*>&);
+    Statement* parseAssnStatement();
+
+    Condition* parseCondition();
+    OpenBlock parseIfStatement();
+    OpenBlock parseForStatement();
+    OpenBlock parseWhileStatement();
+
+    // A part of an expression that holds an expression of its own - the
+    // whole expression, a parenthesized one, an array index or a call
+    // argument. Its operands and pending operators sit on top of
+    // expr_operands and expr_oprs, from the bases on.
+    struct ExprGroup
+    {
+        enum class Kind { TOP, PAREN, INDEX, CALL } kind;
+        size_t operand_base;
+        size_t opr_base;
+
+        // cur_expr_type outside an index or call argument
+        ValueType::Type outer_type = ValueType::Type::MAX;
+        // the array or function
+        Identifier *iden = nullptr;
+        // the call's arguments so far, on call_args from arg_base
+        size_t arg_base = 0;
+    };
 
-    std::unique_ptr<Condition> parseCondition();
-    std::unique_ptr<Statement> parseIfStatement(std::string&);
-    std::unique_ptr<Statement> parseForStatement(std::string&);
-    std::unique_ptr<Statement> parseWhileStatement(std::string&);
+    // parseExpression's stacks, kept between calls
+    std::vector<ExprGroup> expr_groups;
+    std::vector<Expression*> expr_operands;
+    // nullptr is a unary minus
+    std::vector<const BinaryOperator*> expr_oprs;
+    std::vector<Expression*> call_args;
 
-    std::unique_ptr<Expression> parseExpression();
-    std::unique_ptr<Expression> parseTerm(
-        std::unique_ptr<Expression> pending_left = nullptr);
-    std::unique_ptr<Expression> parseFactor();
+    Expression* parseExpression();
+    void openExprGroup(ExprGroup::Kind, Identifier *iden = nullptr);
+    void reduceExpr();
+    Expression* makeCallExpr(Identifier *def, size_t arg_base);
 
-    std::unique_ptr<Expression> parseArrayExpr();
-    std::unique_ptr<Expression> parseIndex();
-    std::unique_ptr<Expression> parseCall();
+    Expression* parseArrayExpr();
+    Expression* parseCall();
 };
 }
 #endif
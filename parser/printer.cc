@@ -0,0 +1,391 @@
+#include "parser/printer.hh"
+
+namespace Frontend
+{
+void ASTPrinter::spaces(unsigned num)
+{
+    static const char blank[] = "                                ";
+    constexpr unsigned BLANK_LEN = sizeof(blank) - 1;
+
+    while (num > BLANK_LEN)
+    {
+        out.write(blank, BLANK_LEN);
+        num -= BLANK_LEN;
+    }
+    out.write(blank, num);
+}
+
+void ASTPrinter::printOperand(Expression *expr, unsigned level, unsigned lead)
+{
+    if (expr->isExprLiteral()) spaces(lead);
+    printExpr(expr, level);
+}
+
+// Each frame is an expression and the number of its children printed so
+// far. The top frame prints up to its next child and pushes it, or
+// finishes; children are never printed by a recursive call.
+void ASTPrinter::printExpr(Expression *root, unsigned root_level)
+{
+    auto base = expr_frames.size();
+    expr_frames.push_back({root, root_level, 0});
+
+    while (expr_frames.size() > base)
+    {
+        auto &frame = expr_frames.back();
+        auto level = frame.level;
+        auto step = frame.step++;
+
+        Expression *child = nullptr;
+        unsigned child_level = 0;
+        frame.expr->visit(Overloaded{
+            [&](LiteralExpression &lit) { out << lit.getLiteral() << "\n"; },
+            [&](ArithExpression &arith)
+            {
+                printArith(&arith, level, step, child, child_level);
+            },
+            [&](ArrayExpression &array)
+            {
+                printArray(&array, level, step, child, child_level);
+            },
+            [&](IndexExpression &index)
+            {
+                printIndex(&index, level, step, child, child_level);
+            },
+            [&](CallExpression &call)
+            {
+                printCall(&call, level, step, child, child_level);
+            }
+        });
+
+        if (child == nullptr)
+            expr_frames.pop_back();
+        else
+            expr_frames.push_back({child, child_level, 0});
+    }
+}
+
+// Calls indent themselves one level less than everything else
+static unsigned childLevel(Expression *child, unsigned level)
+{
+    return child->isExprCall() ? level : level + 1;
+}
+
+void ASTPrinter::printArith(ArithExpression *arith, unsigned level,
+                            unsigned step, Expression *&child,
+                            unsigned &child_level)
+{
+    if (step == 0)
+    {
+        child = arith->getLeft();
+        if (child->isExprLiteral()) indent(level);
+    }
+    else if (step == 1)
+    {
+        indent(level);
+        out << arith->getOperator() << "\n";
+
+        child = arith->getRight();
+        if (child->isExprLiteral()) indent(level);
+    }
+    else
+    {
+        return;
+    }
+    child_level = childLevel(child, level);
+}
+
+void ASTPrinter::printArray(ArrayExpression *array, unsigned level,
+                            unsigned step, Expression *&child,
+                            unsigned &child_level)
+{
+    auto &eles = array->getElements();
+    if (step == 0)
+    {
+        indent(level); out << "{\n";
+        indent(level); out << "  [ARRAY] \n";
+        indent(level); out << "  [NUM ELEMENTS]\n";
+        indent(level); out << "  {\n";
+
+        child = array->getNumElements();
+        child_level = level + 2;
+        if (child->isExprLiteral()) spaces(level * 2 + 4);
+        return;
+    }
+
+    if (step == 1)
+    {
+        indent(level); out << "  }\n";
+
+        indent(level); out << "  [ELEMENTS]\n";
+        indent(level); out << "  {\n";
+    }
+    else
+    {
+        indent(level); out << "    }\n";
+    }
+
+    // element step - 1 is next
+    if (step - 1 < eles.size())
+    {
+        indent(level); out << "    {\n";
+
+        child = eles[step - 1];
+        child_level = level + 3;
+        if (child->isExprLiteral()) spaces(level * 2 + 6);
+        return;
+    }
+    indent(level); out << "  }\n";
+    indent(level); out << "}\n";
+}
+
+void ASTPrinter::printIndex(IndexExpression *index, unsigned level,
+                            unsigned step, Expression *&child,
+                            unsigned &child_level)
+{
+    if (step == 0)
+    {
+        indent(level); out << "{\n";
+        indent(level); out << "  [ARRAY] " << index->getIden() << "\n";
+        indent(level); out << "  [INDEX]\n";
+        indent(level); out << "  {\n";
+
+        child = index->getIndex();
+        child_level = level + 3;
+        if (child->isExprLiteral()) spaces(level * 2 + 6);
+        return;
+    }
+    indent(level); out << "  }\n";
+    indent(level); out << "}\n";
+}
+
+void ASTPrinter::printCall(CallExpression *call, unsigned level,
+                           unsigned step, Expression *&child,
+                           unsigned &child_level)
+{
+    auto &args = call->getArgs();
+    if (step == 0)
+    {
+        indent(level); out << "{\n";
+        indent(level); out << "  [CALL] " << call->getCallFunc() << "\n";
+    }
+    else
+    {
+        indent(level); out << "  }\n";
+    }
+
+    // argument step is next
+    if (step < args.size())
+    {
+        indent(level); out << "  [ARG " << step << "]\n";
+        indent(level); out << "  {\n";
+
+        child = args[step];
+        child_level = level + 2;
+        if (child->isExprLiteral()) spaces(level * 2 + 4);
+        return;
+    }
+    indent(level); out << "}\n";
+}
+
+// Statements nest the same way expressions do, see printExpr
+void ASTPrinter::printStatement(Statement *root)
+{
+    auto base = statement_frames.size();
+    statement_frames.push_back({root, 0});
+
+    while (statement_frames.size() > base)
+    {
+        auto &frame = statement_frames.back();
+        auto step = frame.step++;
+
+        Statement *child = frame.statement->visit(Overloaded{
+            [&](FuncStatement &func) { return printFunc(&func, step); },
+            [&](AssnStatement &assn) -> Statement*
+            {
+                printAssn(&assn);
+                return nullptr;
+            },
+            [&](RetStatement &ret) -> Statement*
+            {
+                printRet(&ret);
+                return nullptr;
+            },
+            [&](CallStatement &call) -> Statement*
+            {
+                printExpr(call.getExpr(), 2);
+                return nullptr;
+            },
+            [&](IfStatement &if_s) { return printIf(&if_s, step); },
+            [&](ForStatement &for_s) { return printFor(&for_s, step); },
+            [&](WhileStatement &while_s) { return printWhile(&while_s, step); }
+        });
+
+        if (child == nullptr)
+            statement_frames.pop_back();
+        else
+            statement_frames.push_back({child, 0});
+    }
+}
+
+void ASTPrinter::printProgram(Program &program)
+{
+    for (auto statement : program.getStatements()) printStatement(statement);
+}
+
+void ASTPrinter::printRet(RetStatement *ret)
+{
+    out << "    {\n";
+    out << "      [Return]\n";
+    printOperand(ret->getRetVal(), 4, 6);
+    out << "    }\n";
+}
+
+void ASTPrinter::printAssn(AssnStatement *assn)
+{
+    out << "    {\n";
+    printOperand(assn->getIden(), 4, 6);
+    out << "      =\n";
+
+    // might have an uninitialized assignment
+    // which will be printed as just "{{iden}} ="
+    if (assn->getExpr() != nullptr) printOperand(assn->getExpr(), 4, 6);
+    out << "    }\n";
+}
+
+Statement* ASTPrinter::printFunc(FuncStatement *func, size_t step)
+{
+    auto &codes = func->getFuncCodes();
+    if (step == 0)
+    {
+        out << "{\n";
+        out << "  Function Name: " << func->getFuncName() << "\n";
+        out << "  Return Type: ";
+        if (func->getRetType() == ValueType::Type::VOID)
+        {
+            out << "void\n";
+        }
+        else if (func->getRetType() == ValueType::Type::INT)
+        {
+            out << "int\n";
+        }
+        else if (func->getRetType() == ValueType::Type::FLOAT)
+        {
+            out << "float\n";
+        }
+
+        out << "  Arguments\n";
+        for (auto &arg : func->getFuncArgs())
+        {
+            out << "    ";
+            if (arg.getArgType() == ValueType::Type::INT) out << "int : ";
+            else if (arg.getArgType() == ValueType::Type::FLOAT) out << "float : ";
+            out << arg.getLiteral() << "\n";
+        }
+        if (!func->getFuncArgs().size()) out << "    NONE\n";
+
+        out << "  Codes\n";
+        out << "  {\n";
+    }
+    if (step < codes.size()) return codes[step];
+
+    out << "  }\n";
+    out << "}\n";
+    return nullptr;
+}
+
+Statement* ASTPrinter::printIf(IfStatement *if_s, size_t step)
+{
+    auto &taken_block = if_s->getTakenBlock();
+    auto &not_taken_block = if_s->getNotTakenBlock();
+    if (step == 0)
+    {
+        out << "  {\n";
+        out << "  [IF Statement] \n";
+        out << "  [Condition]\n";
+        printCond(if_s->getCond());
+        out << "  [Taken Block]\n";
+        out << "  {\n";
+    }
+    if (step < taken_block.size()) return taken_block[step];
+
+    step -= taken_block.size();
+    if (step == 0)
+    {
+        out << "  }\n";
+        if (not_taken_block.size() == 0)
+        {
+            out << "  }\n";
+            return nullptr;
+        }
+        out << "  [Not Taken Block]\n";
+        out << "  {\n";
+    }
+    if (step < not_taken_block.size()) return not_taken_block[step];
+
+    out << "  }\n";
+    out << "  }\n";
+    return nullptr;
+}
+
+Statement* ASTPrinter::printFor(ForStatement *for_s, size_t step)
+{
+    auto &block = for_s->getBlock();
+    if (step == 0)
+    {
+        out << "  {\n";
+        out << "  [For Statement] \n";
+        out << "  [Start]\n";
+        printAssn(for_s->getStart()->as<AssnStatement>());
+        out << "  [End]\n";
+        printCond(for_s->getEnd());
+        out << "  [Step]\n";
+        printAssn(for_s->getStep()->as<AssnStatement>());
+
+        out << "  [Block]\n";
+        out << "  {\n";
+    }
+    if (step < block.size()) return block[step];
+
+    out << "  }\n";
+    out << "  }\n";
+    return nullptr;
+}
+
+Statement* ASTPrinter::printWhile(WhileStatement *while_s, size_t step)
+{
+    auto &block = while_s->getBlock();
+    if (step == 0)
+    {
+        out << "  {\n";
+        out << "  [While Statement] \n";
+        out << "  [End]\n";
+        printCond(while_s->getEnd());
+        out << "  [Block]\n";
+        out << "  {\n";
+    }
+    if (step < block.size()) return block[step];
+
+    out << "  }\n";
+    out << "  }\n";
+    return nullptr;
+}
+
+void ASTPrinter::printCond(Condition *cond)
+{
+    out << "  {\n";
+    out << "    [Left]\n";
+    printOperand(cond->getLeft(), 3, 6);
+    out << "\n";
+    out << "    [COMP] " << cond->getOpr() << "\n\n";
+    out << "    [Right]\n";
+    printOperand(cond->getRight(), 3, 6);
+    out << "\n";
+    out << "  }\n";
+}
+
+void Program::printStatements(std::ostream &out)
+{
+    ASTPrinter printer(out);
+    printer.printProgram(*this);
+}
+}
@@ -0,0 +1,81 @@
+#ifndef __PRINTER_HH__
+#define __PRINTER_HH__
+
+#include "parser/parser.hh"
+
+#include <ostream>
+#include <vector>
+
+namespace Frontend
+{
+/*
+ * AST dump.
+ *
+ * Walks the tree once and writes every line straight into the stream, so
+ * a dump costs time linear in its size no matter how deep the expressions
+ * nest. The walk keeps its own stacks of half-printed nodes rather than
+ * recursing, so nesting depth costs no native stack either. The format is
+ * the one the *_expected_out.txt files were recorded with, quirks
+ * included (the indentation of a child depends on its kind, see
+ * printArith).
+ * */
+class ASTPrinter
+{
+  protected:
+    std::ostream &out;
+
+    // level * 2 spaces, the indentation unit of expressions
+    void indent(unsigned level) { spaces(level * 2); }
+    void spaces(unsigned num);
+
+    // A node partway through printing, step counts its children done
+    struct ExprFrame
+    {
+        Expression *expr;
+        unsigned level;
+        unsigned step;
+    };
+    struct StatementFrame
+    {
+        Statement *statement;
+        size_t step;
+    };
+    std::vector<ExprFrame> expr_frames;
+    std::vector<StatementFrame> statement_frames;
+
+    void printExpr(Expression *expr, unsigned level);
+
+    // Print what comes before child number step and set child (and its
+    // level), or print the rest of the node and leave child nullptr
+    void printArith(ArithExpression *arith, unsigned level, unsigned step,
+                    Expression *&child, unsigned &child_level);
+    void printArray(ArrayExpression *array, unsigned level, unsigned step,
+                    Expression *&child, unsigned &child_level);
+    void printIndex(IndexExpression *index, unsigned level, unsigned step,
+                    Expression *&child, unsigned &child_level);
+    void printCall(CallExpression *call, unsigned level, unsigned step,
+                   Expression *&child, unsigned &child_level);
+
+    // Child expression whose line starts lead spaces in when it is a
+    // literal (literals do not indent themselves)
+    void printOperand(Expression *expr, unsigned level, unsigned lead);
+
+    // The same for blocks, returning the next statement to print
+    Statement* printFunc(FuncStatement *func, size_t step);
+    Statement* printIf(IfStatement *if_s, size_t step);
+    Statement* printFor(ForStatement *for_s, size_t step);
+    Statement* printWhile(WhileStatement *while_s, size_t step);
+
+    void printAssn(AssnStatement *assn);
+    void printRet(RetStatement *ret);
+    void printCond(Condition *cond);
+
+  public:
+    ASTPrinter(std::ostream &_out) : out(_out) {}
+
+    void printStatement(Statement *statement);
+    void printProgram(Program &program);
+};
+}
+
+#endif
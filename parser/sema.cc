@@ -0,0 +1,235 @@
+#include "parser/sema.hh"
+
+namespace Frontend
+{
+void Sema::run()
+{
+    for (auto statement : parser.getProgram().getStatements())
+    {
+        assert(statement->isStatementFunc());
+        funcSema(statement->as<FuncStatement>());
+    }
+}
+
+uint32_t Sema::declare(Symbol sym, ValueType::Type type)
+{
+    uint32_t slot = slots.size();
+    slots.push_back({sym, type});
+    visible[sym] = slot;
+    declared.push_back(sym);
+    return slot;
+}
+
+uint32_t Sema::lookup(Symbol sym)
+{
+    auto iter = visible.find(sym);
+    assert(iter != visible.end() && "variable not in scope");
+    return iter->second;
+}
+
+void Sema::closeScope(size_t mark)
+{
+    while (declared.size() > mark)
+    {
+        visible.erase(declared.back());
+        declared.pop_back();
+    }
+}
+
+void Sema::funcSema(FuncStatement *func)
+{
+    slots.clear();
+    visible.clear();
+    declared.clear();
+
+    for (auto &arg : func->getFuncArgs())
+        declare(arg.getSymbol(), arg.getArgType());
+
+    for (auto statement : func->getFuncCodes()) statementSema(statement);
+
+    func->setSlots(parser.getProgram().getArena().copy(slots));
+}
+
+// Each frame is a statement and the number of its nested statements done
+// so far; blocks nest on the frame stack instead of the native one.
+void Sema::statementSema(Statement *root)
+{
+    frames.push_back({root, 0, 0});
+    while (!frames.empty())
+    {
+        auto &frame = frames.back();
+        auto step = frame.step++;
+
+        Statement *child = frame.statement->visit(Overloaded{
+            [&](FuncStatement&) -> Statement*
+            {
+                assert(false && "[Error] statementSema: nested function. \n");
+                return nullptr;
+            },
+            [&](AssnStatement &assn) -> Statement*
+            {
+                assnSema(&assn);
+                return nullptr;
+            },
+            [&](RetStatement &ret) -> Statement*
+            {
+                if (ret.getRetVal() != nullptr) exprSema(ret.getRetVal());
+                return nullptr;
+            },
+            [&](CallStatement &call) -> Statement*
+            {
+                exprSema(call.getExpr());
+                return nullptr;
+            },
+            [&](IfStatement &if_s) -> Statement*
+            {
+                // Both arms are blocks of their own
+                auto &taken = if_s.getTakenBlock();
+                auto &not_taken = if_s.getNotTakenBlock();
+                if (step == 0)
+                {
+                    condSema(if_s.getCond());
+                    frame.mark = declared.size();
+                }
+                if (step < taken.size()) return taken[step];
+                if (step == taken.size()) closeScope(frame.mark);
+
+                step -= taken.size();
+                if (step < not_taken.size()) return not_taken[step];
+                closeScope(frame.mark);
+                return nullptr;
+            },
+            [&](ForStatement &for_s) -> Statement*
+            {
+                // The start belongs to the block
+                auto &block = for_s.getBlock();
+                if (step == 0)
+                {
+                    frame.mark = declared.size();
+                    assnSema(for_s.getStart()->as<AssnStatement>());
+                    condSema(for_s.getEnd());
+                    assnSema(for_s.getStep()->as<AssnStatement>());
+                }
+                if (step < block.size()) return block[step];
+                closeScope(frame.mark);
+                return nullptr;
+            },
+            [&](WhileStatement &while_s) -> Statement*
+            {
+                auto &block = while_s.getBlock();
+                if (step == 0)
+                {
+                    condSema(while_s.getEnd());
+                    frame.mark = declared.size();
+                }
+                if (step < block.size()) return block[step];
+                closeScope(frame.mark);
+                return nullptr;
+            }
+        });
+
+        if (child == nullptr)
+            frames.pop_back();
+        else
+            frames.push_back({child, 0, 0});
+    }
+}
+
+void Sema::assnSema(AssnStatement *assn)
+{
+    // The variable is in scope from its own initializer on, as it is
+    // for the parser
+    if (assn->isDecl())
+    {
+        auto lit = assn->getIden()->as<LiteralExpression>();
+        assert(lit != nullptr);
+        declare(lit->getSymbol(), assn->getDeclType());
+    }
+
+    exprSema(assn->getIden());
+
+    auto expr = assn->getExpr();
+    if (expr == nullptr) return;
+
+    exprSema(expr);
+    if (expr->isExprArray()) expr->setValueType(assn->getDeclType());
+}
+
+void Sema::condSema(Condition *cond)
+{
+    exprSema(cond->getLeft());
+    exprSema(cond->getRight());
+}
+
+// Bottom up off a stack of (expression, operands done), an expression
+// is typed from the types of its operands
+void Sema::exprSema(Expression *root)
+{
+    pending.push_back({root, false});
+    while (!pending.empty())
+    {
+        auto [expr, operands_done] = pending.back();
+        pending.pop_back();
+
+        if (!operands_done)
+        {
+            pending.push_back({expr, true});
+            auto push = [&](Expression *operand)
+                        { pending.push_back({operand, false}); };
+            expr->visit(Overloaded{
+                [&](LiteralExpression&) {},
+                [&](ArithExpression &arith)
+                {
+                    push(arith.getLeft());
+                    push(arith.getRight());
+                },
+                [&](ArrayExpression &array)
+                {
+                    push(array.getNumElements());
+                    for (auto ele : array.getElements()) push(ele);
+                },
+                [&](IndexExpression &index) { push(index.getIndex()); },
+                [&](CallExpression &call)
+                {
+                    for (auto arg : call.getArgs()) push(arg);
+                }
+            });
+            continue;
+        }
+
+        auto type = expr->visit(Overloaded{
+            [&](LiteralExpression &lit)
+            {
+                if (lit.isVariable())
+                {
+                    lit.setSlot(lookup(lit.getSymbol()));
+                    return slots[lit.getSlot()].type;
+                }
+                return lit.isLiteralFloat() ? ValueType::Type::FLOAT :
+                                              ValueType::Type::INT;
+            },
+            [&](ArithExpression &arith)
+            {
+                // The parser keeps both sides of the same type
+                return arith.getLeft()->getValueType();
+            },
+            [&](ArrayExpression&)
+            {
+                // Typed by the declaration it initializes, see assnSema
+                return ValueType::Type::MAX;
+            },
+            [&](IndexExpression &index)
+            {
+                index.setSlot(lookup(index.getIdenSymbol()));
+                return (slots[index.getSlot()].type == ValueType::Type::FLOAT_ARRAY)
+                       ? ValueType::Type::FLOAT : ValueType::Type::INT;
+            },
+            [&](CallExpression &call)
+            {
+                return parser.getFuncRetType(call.getCallFuncSymbol());
+            }
+        });
+        expr->setValueType(type);
+    }
+}
+}
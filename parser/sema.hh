@@ -0,0 +1,73 @@
+#ifndef __SEMA_HH__
+#define __SEMA_HH__
+
+#include "parser/parser.hh"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Frontend
+{
+/*
+ * Semantic pass, run on the tree after parsing (and folding) and before
+ * anything that executes it.
+ *
+ * Every variable of a function gets a slot - arguments first, then each
+ * declaration in order - and the function keeps the table of them
+ * (FuncStatement::getSlots). Every identifier and array access is
+ * resolved to its slot once, here, so codegen indexes that table instead
+ * of searching scopes by name. Every expression gets its ValueType.
+ *
+ * Scoping follows the parser: a declaration is visible to the end of its
+ * block; if/else arms and loop bodies are blocks, and the start of a for
+ * belongs to its body. The parser has already rejected undefined and
+ * re-defined names, so resolving never fails.
+ * */
+class Sema
+{
+  protected:
+    // for the return types of called functions
+    Parser &parser;
+
+    // slot table of the function being resolved
+    std::vector<LocalSlot> slots;
+
+    // Slot of every variable in scope. Names are not re-declared while in
+    // scope, so one map does; declared lists them in order, a block
+    // drops its own off the end when it closes.
+    std::unordered_map<Symbol,uint32_t> visible;
+    std::vector<Symbol> declared;
+
+    // Statements partway through - the nested statements done so far, and
+    // where the block's declarations start in declared
+    struct StatementFrame
+    {
+        Statement *statement;
+        size_t step;
+        size_t mark;
+    };
+    std::vector<StatementFrame> frames;
+
+    // (expression, operands done) - see exprSema
+    std::vector<std::pair<Expression*,bool>> pending;
+
+    uint32_t declare(Symbol sym, ValueType::Type type);
+    uint32_t lookup(Symbol sym);
+    void closeScope(size_t mark);
+
+    // None of these recurse, deep nesting costs no native stack
+    void funcSema(FuncStatement *func);
+    void statementSema(Statement *root);
+    void assnSema(AssnStatement *assn);
+    void condSema(Condition *cond);
+    void exprSema(Expression *root);
+
+  public:
+    Sema(Parser &_parser) : parser(_parser) {}
+
+    void run();
+};
+}
+
+#endif
@@ -0,0 +1,613 @@
+#include "vm/vm.hh"
+
+#include <algorithm>
+
+namespace Frontend
+{
+static Instr instr(Op op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0,
+                   Reg k = {0}, uint32_t t = 0)
+{
+    return {op, (uint16_t)a, (uint16_t)b, (uint16_t)c, k, t};
+}
+
+static Op opAt(Op first, int idx) { return (Op)((int)first + idx); }
+
+Bytecode BytecodeCompiler::compile()
+{
+    // Every function gets its number first, calls may go either way
+    auto &statements = parser.getProgram().getStatements();
+    for (auto statement : statements)
+    {
+        auto func_statement = statement->as<FuncStatement>();
+        assert(func_statement != nullptr);
+        func_ids[func_statement->getFuncSymbol()] = bytecode.funcs.size();
+        bytecode.funcs.push_back({func_statement->getFuncName()});
+    }
+
+    for (size_t i = 0; i < statements.size(); i++)
+    {
+        func = &bytecode.funcs[i];
+        funcCompile(statements[i]->as<FuncStatement>());
+        bytecode.num_instrs += func->code.size();
+    }
+    return std::move(bytecode);
+}
+
+void BytecodeCompiler::funcCompile(FuncStatement *func_statement)
+{
+    func->num_args = func_statement->getFuncArgs().size();
+    layoutArrays(func_statement);
+    next_temp = temp_base;
+    func->frame_size = temp_base;
+
+    for (auto statement : func_statement->getFuncCodes())
+        statementCompile(statement);
+
+    // Falling off the end returns 0
+    emit(instr(Op::RETV));
+}
+
+// Arrays go right after the variables, each at a fixed place in the frame
+// like an alloca; the temporaries after them
+void BytecodeCompiler::layoutArrays(FuncStatement *func_statement)
+{
+    auto &slots = func_statement->getSlots();
+    arrays.assign(slots.size(), {0, 0});
+    uint32_t top = slots.size();
+
+    auto &codes = func_statement->getFuncCodes();
+    std::vector<Statement*> statements(codes.begin(), codes.end());
+    auto pushBlock = [&](ArenaSpan<Statement*> &block)
+    {
+        statements.insert(statements.end(), block.begin(), block.end());
+    };
+
+    while (!statements.empty())
+    {
+        auto statement = statements.back();
+        statements.pop_back();
+
+        statement->visit(Overloaded{
+            [&](AssnStatement &assn)
+            {
+                auto expr = assn.getExpr();
+                auto array_info = (expr != nullptr) ?
+                                  expr->as<ArrayExpression>() : nullptr;
+                if (!assn.isDecl() || array_info == nullptr) return;
+
+                auto num_ele = array_info->getNumElements()->as<LiteralExpression>();
+                assert(num_ele != nullptr && num_ele->isLiteralInt());
+
+                uint32_t length = num_ele->getInt();
+                if (array_info->getElements().size() > length)
+                {
+                    std::cerr << "[Error] " << array_info->getElements().size()
+                              << " initializers for " << length
+                              << " array elements\n";
+                    exit(0);
+                }
+
+                auto slot = assn.getIden()->as<LiteralExpression>()->getSlot();
+                arrays[slot] = {top, length};
+                top += length;
+            },
+            [&](IfStatement &if_s)
+            {
+                pushBlock(if_s.getTakenBlock());
+                pushBlock(if_s.getNotTakenBlock());
+            },
+            [&](ForStatement &for_s)
+            {
+                statements.push_back(for_s.getStart());
+                pushBlock(for_s.getBlock());
+            },
+            [&](WhileStatement &while_s) { pushBlock(while_s.getBlock()); },
+            [](CallStatement&) {},
+            [](RetStatement&) {},
+            [](FuncStatement&) {}
+        });
+    }
+
+    if (top >= MAX_REGS)
+    {
+        std::cerr << "[Error] " << func->name << " needs more than "
+                  << MAX_REGS << " registers\n";
+        exit(0);
+    }
+    temp_base = top;
+}
+
+uint16_t BytecodeCompiler::allocTemp()
+{
+    if (next_temp >= MAX_REGS)
+    {
+        std::cerr << "[Error] " << func->name << " needs more than "
+                  << MAX_REGS << " registers\n";
+        exit(0);
+    }
+    func->frame_size = std::max(func->frame_size, next_temp + 1);
+    return next_temp++;
+}
+
+// Temporaries are freed in reverse of allocation, the lowest one freed
+// is the top again
+void BytecodeCompiler::release(Operand &op)
+{
+    if (!op.is_const && op.reg >= temp_base)
+        next_temp = std::min(next_temp, (uint32_t)op.reg);
+}
+
+uint16_t BytecodeCompiler::toReg(Operand &op)
+{
+    if (op.is_const)
+    {
+        auto reg = allocTemp();
+        emit(instr(Op::LOADK, reg, 0, 0, op.k));
+        op = {false, reg, {0}};
+    }
+    return op.reg;
+}
+
+// Each frame is a statement and the number of its nested statements
+// compiled so far, nesting depth costs no native stack. Loops test at the
+// bottom: jump to the test, then branch back to the body while it holds.
+void BytecodeCompiler::statementCompile(Statement *root)
+{
+    auto base = frames.size();
+    frames.push_back({root});
+
+    while (frames.size() > base)
+    {
+        auto &frame = frames.back();
+        auto step = frame.step++;
+
+        Statement *child = frame.statement->visit(Overloaded{
+            [&](AssnStatement &assn) -> Statement*
+            {
+                assnCompile(&assn);
+                return nullptr;
+            },
+            [&](CallStatement &call) -> Statement*
+            {
+                if (call.isBuiltIn())
+                {
+                    auto call_expr = call.getCallExpr();
+                    assert(call_expr->getArgs().size() == 1);
+
+                    auto val = expr(call_expr->getArgs()[0]);
+                    auto op = (call_expr->getCallFunc() == "printVarInt") ?
+                              Op::PRINT_I : Op::PRINT_F;
+                    emit(instr(op, toReg(val)));
+                    release(val);
+                }
+                else
+                {
+                    auto val = expr(call.getExpr());
+                    release(val);
+                }
+                return nullptr;
+            },
+            [&](RetStatement &ret) -> Statement*
+            {
+                if (ret.getRetVal() == nullptr)
+                {
+                    emit(instr(Op::RETV));
+                    return nullptr;
+                }
+                auto val = expr(ret.getRetVal());
+                emit(instr(Op::RET, toReg(val)));
+                release(val);
+                return nullptr;
+            },
+            [&](IfStatement &if_s) -> Statement*
+            {
+                auto &taken = if_s.getTakenBlock();
+                auto &not_taken = if_s.getNotTakenBlock();
+                if (step == 0)
+                {
+                    auto cond = if_s.getCond();
+                    if (cond->getType() == ValueType::Type::FLOAT)
+                    {
+                        // Not (a < b) is not a >= b once a NaN is in it,
+                        // branch into the taken block instead
+                        auto to_taken = branch(cond, true, 0);
+                        frame.jump = emit(instr(Op::JMP));
+                        patch(to_taken);
+                    }
+                    else
+                    {
+                        frame.jump = branch(cond, false, 0);
+                    }
+                }
+                if (step < taken.size()) return taken[step];
+
+                step -= taken.size();
+                if (step == 0 && !not_taken.empty())
+                {
+                    auto to_end = emit(instr(Op::JMP));
+                    patch(frame.jump);
+                    frame.jump = to_end;
+                }
+                if (step < not_taken.size()) return not_taken[step];
+
+                patch(frame.jump);
+                return nullptr;
+            },
+            [&](ForStatement &for_s) -> Statement*
+            {
+                auto &block = for_s.getBlock();
+                if (step == 0)
+                {
+                    assnCompile(for_s.getStart()->as<AssnStatement>());
+                    frame.jump = emit(instr(Op::JMP));
+                    frame.body = here();
+                }
+                if (step < block.size()) return block[step];
+
+                assnCompile(for_s.getStep()->as<AssnStatement>());
+                patch(frame.jump);
+                branch(for_s.getEnd(), true, frame.body);
+                return nullptr;
+            },
+            [&](WhileStatement &while_s) -> Statement*
+            {
+                auto &block = while_s.getBlock();
+                if (step == 0)
+                {
+                    frame.jump = emit(instr(Op::JMP));
+                    frame.body = here();
+                }
+                if (step < block.size()) return block[step];
+
+                patch(frame.jump);
+                branch(while_s.getEnd(), true, frame.body);
+                return nullptr;
+            },
+            [&](FuncStatement&) -> Statement*
+            {
+                assert(false && "[Error] statementCompile: nested function. \n");
+                return nullptr;
+            }
+        });
+
+        if (child == nullptr)
+            frames.pop_back();
+        else
+            frames.push_back({child});
+    }
+}
+
+// Values are computed straight into the variable or element they are
+// stored to
+void BytecodeCompiler::assnCompile(AssnStatement *assn)
+{
+    auto iden = assn->getIden();
+    auto value = assn->getExpr();
+
+    if (auto index = iden->as<IndexExpression>())
+    {
+        auto [array, length] = arrays[index->getSlot()];
+
+        // The index goes first, as codegen has it
+        auto idx = expr(index->getIndex());
+        auto val = expr(value);
+        auto val_reg = toReg(val);
+        if (idx.is_const && (uint32_t)idx.k.i < length)
+        {
+            emit(instr(Op::MOV, array + idx.k.i, val_reg));
+        }
+        else
+        {
+            Reg k;
+            k.i = length;
+            emit(instr(Op::STOREX, val_reg, toReg(idx), 0, k, array));
+        }
+        release(idx);
+        release(val);
+        return;
+    }
+
+    auto lit = iden->as<LiteralExpression>();
+    assert(lit != nullptr);
+    auto slot = lit->getSlot();
+
+    if (value == nullptr)
+    {
+        // Declared without a value, starts at 0
+        emit(instr(Op::LOADK, slot));
+    }
+    else if (auto array_info = value->as<ArrayExpression>())
+    {
+        auto array = arrays[slot].first;
+        for (auto ele : array_info->getElements()) expr(ele, array++);
+    }
+    else
+    {
+        expr(value, slot);
+    }
+}
+
+// The branch goes to target (or wherever it is patched to) when the
+// condition is jump_if. Only int conditions may jump on false.
+uint32_t BytecodeCompiler::branch(Condition *cond, bool jump_if,
+                                  uint32_t target)
+{
+    static const std::string_view oprs[] = {"==", "!=", ">", ">=", "<", "<="};
+    // not (a cmp b), and b cmp' a for a cmp b
+    static const int negated[] = {1, 0, 5, 4, 3, 2};
+    static const int swapped[] = {0, 1, 4, 5, 2, 3};
+
+    int cmp = 0;
+    while (oprs[cmp] != cond->getOpr()) cmp++;
+
+    bool is_float = (cond->getType() == ValueType::Type::FLOAT);
+    assert(jump_if || !is_float);
+    int type = is_float ? 6 : 0;
+
+    auto left = expr(cond->getLeft());
+    auto right = expr(cond->getRight());
+
+    uint32_t jump;
+    if (super)
+    {
+        if (!jump_if) cmp = negated[cmp];
+        if (left.is_const && !right.is_const)
+        {
+            std::swap(left, right);
+            cmp = swapped[cmp];
+        }
+
+        if (right.is_const)
+        {
+            auto left_reg = toReg(left);
+            jump = emit(instr(opAt(Op::JEQK_I, type + cmp), left_reg, 0, 0,
+                              right.k, target));
+        }
+        else
+        {
+            jump = emit(instr(opAt(Op::JEQ_I, type + cmp), left.reg, right.reg,
+                              0, {0}, target));
+        }
+        bytecode.num_fused++;
+    }
+    else
+    {
+        auto left_reg = toReg(left);
+        auto right_reg = toReg(right);
+        Operand result{false, allocTemp(), {0}};
+        emit(instr(opAt(Op::EQ_I, type + cmp), result.reg, left_reg, right_reg));
+        jump = emit(instr(jump_if ? Op::JT : Op::JF, result.reg, 0, 0, {0},
+                          target));
+        release(result);
+    }
+    release(right);
+    release(left);
+    return jump;
+}
+
+// Post-order off a stack of (expression, state): EXPAND pushes the
+// operands, REDUCE emits the node once they are done, ARG moves a call
+// argument into its place. Operands wait on operands. The root's value
+// goes to dest if there is one.
+BytecodeCompiler::Operand BytecodeCompiler::expr(Expression *root, int32_t dest)
+{
+    pending.push_back({root, ExprState::EXPAND});
+    while (!pending.empty())
+    {
+        auto [e, state] = pending.back();
+        pending.pop_back();
+
+        if (state == ExprState::REDUCE)
+        {
+            reduce(e, root, dest);
+            continue;
+        }
+
+        if (state == ExprState::ARG)
+        {
+            // Arguments go in consecutive registers; one that is
+            // already the top temporary is in place
+            auto &arg = operands.back();
+            if (arg.is_const || arg.reg < temp_base || arg.reg + 1 != next_temp)
+            {
+                auto reg = allocTemp();
+                if (arg.is_const)
+                    emit(instr(Op::LOADK, reg, 0, 0, arg.k));
+                else
+                    emit(instr(Op::MOV, reg, arg.reg));
+                arg = {false, reg, {0}};
+            }
+            continue;
+        }
+
+        if (auto lit = e->as<LiteralExpression>())
+        {
+            Operand op{!lit->isVariable(), 0, {0}};
+            if (lit->isVariable())
+                op.reg = lit->getSlot();
+            else if (lit->isLiteralInt())
+                op.k.i = lit->getInt();
+            else
+                op.k.f = lit->getFloat();
+            operands.push_back(op);
+            continue;
+        }
+
+        pending.push_back({e, ExprState::REDUCE});
+        auto push = [&](Expression *operand)
+                    { pending.push_back({operand, ExprState::EXPAND}); };
+        e->visit(Overloaded{
+            [&](LiteralExpression&) {},
+            [&](ArithExpression &arith)
+            {
+                // The order codegen evaluates them in
+                if (rightFirst(&arith))
+                {
+                    push(arith.getLeft());
+                    push(arith.getRight());
+                }
+                else
+                {
+                    push(arith.getRight());
+                    push(arith.getLeft());
+                }
+            },
+            [&](IndexExpression &index) { push(index.getIndex()); },
+            [&](CallExpression &call)
+            {
+                auto &args = call.getArgs();
+                for (auto iter = args.end(); iter != args.begin(); )
+                {
+                    --iter;
+                    pending.push_back({*iter, ExprState::ARG});
+                    push(*iter);
+                }
+            },
+            [&](ArrayExpression&)
+            {
+                assert(false && "[Error] expr: array outside a declaration. \n");
+            }
+        });
+    }
+
+    auto result = operands.back();
+    operands.pop_back();
+    if (dest >= 0 && (result.is_const || result.reg != dest))
+    {
+        // A bare literal or variable
+        if (result.is_const)
+            emit(instr(Op::LOADK, dest, 0, 0, result.k));
+        else
+            emit(instr(Op::MOV, dest, result.reg));
+        release(result);
+        result = {false, (uint16_t)dest, {0}};
+    }
+    return result;
+}
+
+// Operands are freed before the result is allocated, so it takes the
+// lowest of their temporaries; every op reads its operands before it
+// writes.
+void BytecodeCompiler::reduce(Expression *e, Expression *root, int32_t dest)
+{
+    auto target = [&]() -> uint16_t
+    {
+        return (e == root && dest >= 0) ? dest : allocTemp();
+    };
+    auto pop = [&]()
+    {
+        auto op = operands.back();
+        operands.pop_back();
+        return op;
+    };
+
+    e->visit(Overloaded{
+        [&](LiteralExpression&) {},
+        [&](ArithExpression &arith)
+        {
+            auto second = pop();
+            auto first = pop();
+            auto left = rightFirst(&arith) ? second : first;
+            auto right = rightFirst(&arith) ? first : second;
+
+            auto opr = arith.getType();
+            int idx = (int)opr - (int)ExpressionType::PLUS;
+            bool is_float = (e->getValueType() == ValueType::Type::FLOAT);
+            if (is_float) idx += 4;
+
+            release(right);
+            release(left);
+            auto to = target();
+
+            auto &code = func->code;
+            if (left.is_const && right.is_const)
+            {
+                emit(instr(Op::LOADK, to, 0, 0, left.k));
+                emit(instr(opAt(Op::ADDK_I, idx), to, to, 0, right.k));
+            }
+            else if (right.is_const)
+            {
+                emit(instr(opAt(Op::ADDK_I, idx), to, left.reg, 0, right.k));
+            }
+            else if (left.is_const)
+            {
+                Op op;
+                if (opr == ExpressionType::MINUS)
+                    op = is_float ? Op::RSUBK_F : Op::RSUBK_I;
+                else if (opr == ExpressionType::SLASH)
+                    op = is_float ? Op::RDIVK_F : Op::RDIVK_I;
+                else
+                    op = opAt(Op::ADDK_I, idx);
+                emit(instr(op, to, right.reg, 0, left.k));
+            }
+            else if (super && opr == ExpressionType::PLUS &&
+                     !code.empty() && code.back().op == Op::LOADX &&
+                     code.back().a >= temp_base &&
+                     left.reg != right.reg &&
+                     (code.back().a == left.reg || code.back().a == right.reg))
+            {
+                // The load that made one operand was the last thing
+                // emitted, fold it into the add
+                auto load = code.back();
+                auto other = (load.a == left.reg) ? right.reg : left.reg;
+                code.back() = instr(is_float ? Op::ADDX_F : Op::ADDX_I,
+                                    to, other, load.b, load.k, load.t);
+                bytecode.num_fused++;
+            }
+            else
+            {
+                emit(instr(opAt(Op::ADD_I, idx), to, left.reg, right.reg));
+            }
+            operands.push_back({false, to, {0}});
+        },
+        [&](IndexExpression &index)
+        {
+            auto [array, length] = arrays[index.getSlot()];
+            auto idx = pop();
+
+            uint16_t to;
+            if (idx.is_const && (uint32_t)idx.k.i < length)
+            {
+                to = target();
+                emit(instr(Op::MOV, to, array + idx.k.i));
+            }
+            else
+            {
+                auto idx_reg = toReg(idx);
+                release(idx);
+                to = target();
+
+                Reg k;
+                k.i = length;
+                emit(instr(Op::LOADX, to, idx_reg, 0, k, array));
+            }
+            operands.push_back({false, to, {0}});
+        },
+        [&](CallExpression &call)
+        {
+            auto num_args = call.getArgs().size();
+            uint16_t first = 0;
+            if (num_args > 0) first = operands[operands.size() - num_args].reg;
+            for (size_t i = 0; i < num_args; i++)
+            {
+                auto arg = pop();
+                release(arg);
+            }
+
+            auto iter = func_ids.find(call.getCallFuncSymbol());
+            if (iter == func_ids.end())
+            {
+                std::cerr << "[Error] Please define function before CALL\n";
+                exit(0);
+            }
+
+            auto to = target();
+            Reg k;
+            k.i = iter->second;
+            emit(instr(Op::CALL, to, first, num_args, k));
+            operands.push_back({false, to, {0}});
+        },
+        [&](ArrayExpression&) {}
+    });
+}
+}
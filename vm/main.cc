@@ -0,0 +1,64 @@
+#include "parser/parser.hh"
+#include "parser/fold.hh"
+#include "parser/sema.hh"
+#include "vm/vm.hh"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace Frontend;
+
+int main(int argc, char* argv[])
+{
+    // vm [--cache DIR] [--no-fold] [--no-super] [--stats] <source>
+    //   --cache DIR - take the AST from the cache in DIR, parse and save
+    //                 it there on a miss
+    //   --no-fold   - run every operation as written, no constant folding
+    //   --no-super  - plain instructions only, no superinstructions
+    //   --stats     - print the size of the bytecode to stderr
+    // Exits with what main returns, like the compiled program.
+    const char* cache_dir = nullptr;
+    bool fold = true;
+    bool super = true;
+    bool stats = false;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--no-fold") == 0)
+            fold = false;
+        else if (strcmp(argv[i], "--no-super") == 0)
+            super = false;
+        else if (strcmp(argv[i], "--stats") == 0)
+            stats = true;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != 1)
+    {
+        std::cerr << "[Error] usage: vm [--cache DIR] [--no-fold] [--no-super] [--stats] <source>\n";
+        exit(0);
+    }
+
+    // Parser
+    Parser parser(files[0], false, 1, cache_dir);
+
+    // AST passes
+    if (fold) ASTFolder(parser.getProgram()).foldProgram();
+    Sema(parser).run();
+
+    // Bytecode
+    auto bytecode = BytecodeCompiler(parser, super).compile();
+    if (stats)
+    {
+        std::cerr << "Bytecode: " << bytecode.num_instrs << " instructions in "
+                  << bytecode.funcs.size() << " functions, "
+                  << bytecode.num_fused << " superinstructions\n";
+    }
+
+    // Run
+    VM vm(bytecode);
+    return vm.run();
+}
@@ -0,0 +1,34 @@
+# Times every program in bench_apps on the VM, with and without
+# superinstructions, on the tree-walking interpreter, and compiled
+# natively at -O0 and -O2. Build vm, ../interp and ../codegen first.
+
+CC=${CC:-clang}
+
+for app in bench_apps/*.txt; do
+  name=$(basename $app .txt)
+  echo "== $name"
+
+  echo "VM:"
+  time ./vm $app
+  echo ""
+
+  echo "VM, no superinstructions:"
+  time ./vm --no-super $app
+  echo ""
+
+  echo "Interpreter:"
+  time ../interp/interp $app
+  echo ""
+
+  ../codegen/codegen $app $name.bc > /dev/null 2>&1
+  llvm-link $name.bc ../codegen/util/print.bc -o linked.bc
+  for level in 0 2; do
+    opt -O$level linked.bc -o optimized.bc
+    llc -O$level -filetype=obj optimized.bc -o linked.o
+    $CC linked.o -o out
+    echo "Native -O$level:"
+    time ./out
+    echo ""
+  done
+  rm $name.bc linked.bc optimized.bc linked.o out
+done
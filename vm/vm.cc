@@ -0,0 +1,217 @@
+#include "vm/vm.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace Frontend
+{
+// One handler per op, in Op order. Each ends by jumping to the handler of
+// the next instruction, so every op has its own indirect branch for the
+// predictor to learn.
+int32_t VM::run()
+{
+    static void* const handlers[] =
+    {
+        &&LOADK, &&MOV,
+        &&ADD_I, &&SUB_I, &&MUL_I, &&DIV_I,
+        &&ADD_F, &&SUB_F, &&MUL_F, &&DIV_F,
+        &&ADDK_I, &&SUBK_I, &&MULK_I, &&DIVK_I,
+        &&ADDK_F, &&SUBK_F, &&MULK_F, &&DIVK_F,
+        &&RSUBK_I, &&RDIVK_I, &&RSUBK_F, &&RDIVK_F,
+        &&LOADX, &&STOREX,
+        &&EQ_I, &&NE_I, &&GT_I, &&GE_I, &&LT_I, &&LE_I,
+        &&EQ_F, &&NE_F, &&GT_F, &&GE_F, &&LT_F, &&LE_F,
+        &&JT, &&JF, &&JMP,
+        &&CALL, &&RET, &&RETV,
+        &&PRINT_I, &&PRINT_F,
+        &&ADDX_I, &&ADDX_F,
+        &&JEQ_I, &&JNE_I, &&JGT_I, &&JGE_I, &&JLT_I, &&JLE_I,
+        &&JEQ_F, &&JNE_F, &&JGT_F, &&JGE_F, &&JLT_F, &&JLE_F,
+        &&JEQK_I, &&JNEK_I, &&JGTK_I, &&JGEK_I, &&JLTK_I, &&JLEK_I,
+        &&JEQK_F, &&JNEK_F, &&JGTK_F, &&JGEK_F, &&JLTK_F, &&JLEK_F
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == (size_t)Op::NUM_OPS,
+                  "a handler for every op");
+
+    const BytecodeFunction *func = nullptr;
+    for (auto &candidate : bytecode.funcs)
+    {
+        if (candidate.name == "main") func = &candidate;
+    }
+    if (func == nullptr)
+    {
+        std::cerr << "[Error] no main function to run\n";
+        exit(0);
+    }
+
+    // A fresh frame is all zeros
+    uint32_t base = 0;
+    regs.assign(std::max<size_t>(func->frame_size, 1024), Reg{0});
+    Reg *r = regs.data();
+    const Instr *code = func->code.data();
+    const Instr *ip = code;
+    Reg ret;
+
+    // Ints wrap like the i32 ops codegen emits; what would trap compiled
+    // is an error here
+    auto wrap = [](uint32_t val) { return (int32_t)val; };
+    auto divide = [](int32_t lhs, int32_t rhs)
+    {
+        if (rhs == 0 || (lhs == INT_MIN && rhs == -1))
+        {
+            std::cerr << "[Error] integer division " << lhs << " / " << rhs
+                      << " traps\n";
+            exit(0);
+        }
+        return lhs / rhs;
+    };
+    auto index = [](int32_t idx, int32_t length)
+    {
+        if ((uint32_t)idx >= (uint32_t)length)
+        {
+            std::cerr << "[Error] index " << idx << " out of bounds of "
+                      << length << " array elements\n";
+            exit(0);
+        }
+        return idx;
+    };
+
+#define DISPATCH() goto *handlers[(size_t)ip->op]
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+#define JUMP_IF(cond) do { ip = (cond) ? code + ip->t : ip + 1; DISPATCH(); } while (0)
+
+    DISPATCH();
+
+LOADK:  r[ip->a] = ip->k; NEXT();
+MOV:    r[ip->a] = r[ip->b]; NEXT();
+
+ADD_I:  r[ip->a].i = wrap((uint32_t)r[ip->b].i + r[ip->c].i); NEXT();
+SUB_I:  r[ip->a].i = wrap((uint32_t)r[ip->b].i - r[ip->c].i); NEXT();
+MUL_I:  r[ip->a].i = wrap((uint32_t)r[ip->b].i * r[ip->c].i); NEXT();
+DIV_I:  r[ip->a].i = divide(r[ip->b].i, r[ip->c].i); NEXT();
+ADD_F:  r[ip->a].f = r[ip->b].f + r[ip->c].f; NEXT();
+SUB_F:  r[ip->a].f = r[ip->b].f - r[ip->c].f; NEXT();
+MUL_F:  r[ip->a].f = r[ip->b].f * r[ip->c].f; NEXT();
+DIV_F:  r[ip->a].f = r[ip->b].f / r[ip->c].f; NEXT();
+
+ADDK_I: r[ip->a].i = wrap((uint32_t)r[ip->b].i + ip->k.i); NEXT();
+SUBK_I: r[ip->a].i = wrap((uint32_t)r[ip->b].i - ip->k.i); NEXT();
+MULK_I: r[ip->a].i = wrap((uint32_t)r[ip->b].i * ip->k.i); NEXT();
+DIVK_I: r[ip->a].i = divide(r[ip->b].i, ip->k.i); NEXT();
+ADDK_F: r[ip->a].f = r[ip->b].f + ip->k.f; NEXT();
+SUBK_F: r[ip->a].f = r[ip->b].f - ip->k.f; NEXT();
+MULK_F: r[ip->a].f = r[ip->b].f * ip->k.f; NEXT();
+DIVK_F: r[ip->a].f = r[ip->b].f / ip->k.f; NEXT();
+
+RSUBK_I: r[ip->a].i = wrap((uint32_t)ip->k.i - r[ip->b].i); NEXT();
+RDIVK_I: r[ip->a].i = divide(ip->k.i, r[ip->b].i); NEXT();
+RSUBK_F: r[ip->a].f = ip->k.f - r[ip->b].f; NEXT();
+RDIVK_F: r[ip->a].f = ip->k.f / r[ip->b].f; NEXT();
+
+LOADX:  r[ip->a] = r[ip->t + index(r[ip->b].i, ip->k.i)]; NEXT();
+STOREX: r[ip->t + index(r[ip->b].i, ip->k.i)] = r[ip->a]; NEXT();
+
+// Float compares are ordered, false if either side is NaN
+EQ_I:   r[ip->a].i = (r[ip->b].i == r[ip->c].i); NEXT();
+NE_I:   r[ip->a].i = (r[ip->b].i != r[ip->c].i); NEXT();
+GT_I:   r[ip->a].i = (r[ip->b].i > r[ip->c].i); NEXT();
+GE_I:   r[ip->a].i = (r[ip->b].i >= r[ip->c].i); NEXT();
+LT_I:   r[ip->a].i = (r[ip->b].i < r[ip->c].i); NEXT();
+LE_I:   r[ip->a].i = (r[ip->b].i <= r[ip->c].i); NEXT();
+EQ_F:   r[ip->a].i = (r[ip->b].f == r[ip->c].f); NEXT();
+NE_F:   r[ip->a].i = (r[ip->b].f < r[ip->c].f || r[ip->b].f > r[ip->c].f); NEXT();
+GT_F:   r[ip->a].i = (r[ip->b].f > r[ip->c].f); NEXT();
+GE_F:   r[ip->a].i = (r[ip->b].f >= r[ip->c].f); NEXT();
+LT_F:   r[ip->a].i = (r[ip->b].f < r[ip->c].f); NEXT();
+LE_F:   r[ip->a].i = (r[ip->b].f <= r[ip->c].f); NEXT();
+
+JT:     JUMP_IF(r[ip->a].i != 0);
+JF:     JUMP_IF(r[ip->a].i == 0);
+JMP:    ip = code + ip->t; DISPATCH();
+
+CALL:
+    {
+        // The callee's frame goes right above ours, its arguments are
+        // copied to its first registers
+        auto callee = &bytecode.funcs[ip->k.i];
+        if (calls.size() >= MAX_CALL_DEPTH)
+        {
+            std::cerr << "[Error] calls nested over " << MAX_CALL_DEPTH
+                      << " deep\n";
+            exit(0);
+        }
+
+        uint32_t callee_base = base + func->frame_size;
+        size_t need = (size_t)callee_base + callee->frame_size;
+        if (regs.size() < need) regs.resize(std::max(need, regs.size() * 2));
+        r = regs.data() + base;
+
+        Reg *callee_r = regs.data() + callee_base;
+        std::fill(callee_r, callee_r + callee->frame_size, Reg{0});
+        std::copy(r + ip->b, r + ip->b + ip->c, callee_r);
+
+        calls.push_back({func, ip + 1, base, ip->a});
+        func = callee;
+        base = callee_base;
+        r = callee_r;
+        code = ip = func->code.data();
+        DISPATCH();
+    }
+RET:    ret = r[ip->a]; goto RETURN;
+RETV:   ret.i = 0; goto RETURN;
+RETURN:
+    {
+        if (calls.empty()) return ret.i;
+
+        auto caller = calls.back();
+        calls.pop_back();
+        func = caller.func;
+        base = caller.base;
+        r = regs.data() + base;
+        r[caller.dest] = ret;
+        code = func->code.data();
+        ip = caller.ret_ip;
+        DISPATCH();
+    }
+
+// As util/print.c
+PRINT_I: printf("%d\n", r[ip->a].i); NEXT();
+PRINT_F: printf("%f\n", r[ip->a].f); NEXT();
+
+ADDX_I: r[ip->a].i = wrap((uint32_t)r[ip->b].i +
+                          r[ip->t + index(r[ip->c].i, ip->k.i)].i); NEXT();
+ADDX_F: r[ip->a].f = r[ip->b].f + r[ip->t + index(r[ip->c].i, ip->k.i)].f;
+        NEXT();
+
+JEQ_I:  JUMP_IF(r[ip->a].i == r[ip->b].i);
+JNE_I:  JUMP_IF(r[ip->a].i != r[ip->b].i);
+JGT_I:  JUMP_IF(r[ip->a].i > r[ip->b].i);
+JGE_I:  JUMP_IF(r[ip->a].i >= r[ip->b].i);
+JLT_I:  JUMP_IF(r[ip->a].i < r[ip->b].i);
+JLE_I:  JUMP_IF(r[ip->a].i <= r[ip->b].i);
+JEQ_F:  JUMP_IF(r[ip->a].f == r[ip->b].f);
+JNE_F:  JUMP_IF(r[ip->a].f < r[ip->b].f || r[ip->a].f > r[ip->b].f);
+JGT_F:  JUMP_IF(r[ip->a].f > r[ip->b].f);
+JGE_F:  JUMP_IF(r[ip->a].f >= r[ip->b].f);
+JLT_F:  JUMP_IF(r[ip->a].f < r[ip->b].f);
+JLE_F:  JUMP_IF(r[ip->a].f <= r[ip->b].f);
+
+JEQK_I: JUMP_IF(r[ip->a].i == ip->k.i);
+JNEK_I: JUMP_IF(r[ip->a].i != ip->k.i);
+JGTK_I: JUMP_IF(r[ip->a].i > ip->k.i);
+JGEK_I: JUMP_IF(r[ip->a].i >= ip->k.i);
+JLTK_I: JUMP_IF(r[ip->a].i < ip->k.i);
+JLEK_I: JUMP_IF(r[ip->a].i <= ip->k.i);
+JEQK_F: JUMP_IF(r[ip->a].f == ip->k.f);
+JNEK_F: JUMP_IF(r[ip->a].f < ip->k.f || r[ip->a].f > ip->k.f);
+JGTK_F: JUMP_IF(r[ip->a].f > ip->k.f);
+JGEK_F: JUMP_IF(r[ip->a].f >= ip->k.f);
+JLTK_F: JUMP_IF(r[ip->a].f < ip->k.f);
+JLEK_F: JUMP_IF(r[ip->a].f <= ip->k.f);
+
+#undef JUMP_IF
+#undef NEXT
+#undef DISPATCH
+}
+}
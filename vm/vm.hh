@@ -0,0 +1,212 @@
+#ifndef __VM_HH__
+#define __VM_HH__
+
+#include "parser/parser.hh"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Frontend
+{
+/*
+ * Register bytecode, compiled from a parsed (folded) and resolved
+ * (parser/sema.hh) program, and the VM that runs it.
+ *
+ * Every function has a frame of registers: its variables by slot, then
+ * its arrays, then temporaries, allocated like a stack as expressions are
+ * compiled. Variables are used in place, x = y + 1 is one instruction.
+ * A fresh frame is all zeros.
+ *
+ * The VM dispatches with computed goto (a GNU extension, g++ and clang++
+ * have it), every handler jumps straight to the next one. Calls push a
+ * frame on the VM's own stack, nothing recurses natively.
+ *
+ * Superinstructions, emitted unless turned off:
+ *   ADDX_*  - an array load feeding an add, s = s + a[i]
+ *   J*_*    - a compare feeding a branch; J*K_* compare with an
+ *             immediate. Loops test at the bottom, one branch per trip.
+ * */
+
+// A register, an int or a float
+union Reg
+{
+    int32_t i;
+    float f;
+};
+
+// r[x] is register x of the frame. Arrays live in registers too; the
+// indexed ops find the array at register t, k.i elements long.
+enum class Op : uint16_t
+{
+    LOADK,                          // r[a] = k
+    MOV,                            // r[a] = r[b]
+
+    ADD_I, SUB_I, MUL_I, DIV_I,     // r[a] = r[b] op r[c]
+    ADD_F, SUB_F, MUL_F, DIV_F,
+    ADDK_I, SUBK_I, MULK_I, DIVK_I, // r[a] = r[b] op k
+    ADDK_F, SUBK_F, MULK_F, DIVK_F,
+    RSUBK_I, RDIVK_I,               // r[a] = k op r[b]
+    RSUBK_F, RDIVK_F,
+
+    LOADX,                          // r[a] = r[t + r[b]]
+    STOREX,                         // r[t + r[b]] = r[a]
+
+    EQ_I, NE_I, GT_I, GE_I, LT_I, LE_I, // r[a] = r[b] cmp r[c]
+    EQ_F, NE_F, GT_F, GE_F, LT_F, LE_F,
+    JT, JF,                         // to t if r[a] is / is not 0
+    JMP,                            // to t
+
+    CALL,                           // r[a] = function k.i(r[b] ... r[b + c - 1])
+    RET,                            // return r[a]
+    RETV,                           // return, no value
+    PRINT_I, PRINT_F,               // printVarInt/printVarFloat(r[a])
+
+    // Superinstructions
+    ADDX_I, ADDX_F,                 // r[a] = r[b] + r[t + r[c]]
+    JEQ_I, JNE_I, JGT_I, JGE_I, JLT_I, JLE_I,     // to t if r[a] cmp r[b]
+    JEQ_F, JNE_F, JGT_F, JGE_F, JLT_F, JLE_F,
+    JEQK_I, JNEK_I, JGTK_I, JGEK_I, JLTK_I, JLEK_I, // to t if r[a] cmp k
+    JEQK_F, JNEK_F, JGTK_F, JGEK_F, JLTK_F, JLEK_F,
+
+    NUM_OPS
+};
+
+struct Instr
+{
+    Op op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+    Reg k{0};
+    uint32_t t = 0;
+};
+
+struct BytecodeFunction
+{
+    std::string_view name;
+    uint32_t num_args = 0;
+    uint32_t frame_size = 0;
+    std::vector<Instr> code;
+};
+
+struct Bytecode
+{
+    std::vector<BytecodeFunction> funcs;
+
+    // what the compiler did
+    size_t num_instrs = 0;
+    size_t num_fused = 0;
+};
+
+class BytecodeCompiler
+{
+  protected:
+    // Frames hold at most this many registers, operands are 16 bits
+    static constexpr uint32_t MAX_REGS = UINT16_MAX + 1;
+
+    Parser &parser;
+    bool super;
+
+    Bytecode bytecode;
+    std::unordered_map<Symbol, uint32_t> func_ids;
+
+    // Function being compiled, its arrays by slot (register, elements)
+    // and its temporaries
+    BytecodeFunction *func = nullptr;
+    std::vector<std::pair<uint32_t,uint32_t>> arrays;
+    uint32_t temp_base = 0;
+    uint32_t next_temp = 0;
+
+    // A compiled expression - a register, or a number not loaded yet
+    struct Operand
+    {
+        bool is_const;
+        uint16_t reg;
+        Reg k;
+    };
+
+    // A statement partway through compiling - the nested statements done
+    // so far, the branch still to be pointed at its target, and the top
+    // of a loop body
+    struct StatementFrame
+    {
+        Statement *statement;
+        size_t step = 0;
+        uint32_t jump = 0;
+        uint32_t body = 0;
+    };
+    std::vector<StatementFrame> frames;
+
+    // (expression, state) and the operands waiting for their node, see
+    // expr
+    enum class ExprState { EXPAND, REDUCE, ARG };
+    std::vector<std::pair<Expression*,ExprState>> pending;
+    std::vector<Operand> operands;
+
+    uint32_t here() { return func->code.size(); }
+    uint32_t emit(Instr instr)
+    {
+        func->code.push_back(instr);
+        return func->code.size() - 1;
+    }
+    void patch(uint32_t jump) { func->code[jump].t = here(); }
+
+    uint16_t allocTemp();
+    void release(Operand &op);
+    uint16_t toReg(Operand &op);
+
+    void funcCompile(FuncStatement *func_statement);
+    void layoutArrays(FuncStatement *func_statement);
+    void statementCompile(Statement *root);
+    void assnCompile(AssnStatement *assn);
+    uint32_t branch(Condition *cond, bool jump_if, uint32_t target);
+    Operand expr(Expression *root, int32_t dest = -1);
+    void reduce(Expression *expr, Expression *root, int32_t dest);
+
+    static bool rightFirst(ArithExpression *arith)
+    {
+        return !arith->getLeft()->isExprArith() &&
+               arith->getRight()->isExprArith();
+    }
+
+  public:
+    // super - emit superinstructions
+    BytecodeCompiler(Parser &_parser, bool _super = true)
+        : parser(_parser)
+        , super(_super)
+    {}
+
+    Bytecode compile();
+};
+
+class VM
+{
+  protected:
+    static constexpr size_t MAX_CALL_DEPTH = 100000;
+
+    Bytecode &bytecode;
+
+    // Frames of every call in progress, innermost last
+    std::vector<Reg> regs;
+
+    struct CallFrame
+    {
+        const BytecodeFunction *func;
+        const Instr *ret_ip;
+        uint32_t base;
+        uint16_t dest;
+    };
+    std::vector<CallFrame> calls;
+
+  public:
+    VM(Bytecode &_bytecode) : bytecode(_bytecode) {}
+
+    // Run main, its return value
+    int32_t run();
+};
+}
+
+#endif